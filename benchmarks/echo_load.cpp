@@ -0,0 +1,147 @@
+// Loopback load generator for the echo servers. Every connection writes a
+// message, reads the echo back and starts over; each round trip is one
+// request. Runs one pass per message size and connection count and prints
+// requests per second with latency percentiles.
+//
+//   echo_load [port] [seconds] [sizes] [connections]
+//   echo_load 12345 5 64,1024,16384 1,16,128
+
+#include <ioring/uring.hpp>
+#include <ioring/stream_socket.hpp>
+#include <ioring/read_write.hpp>
+#include <ioring/steady_timer.hpp>
+#include <ioring/stats.hpp>
+#include <ioring/tcp.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+using namespace ioring;
+
+struct load
+{
+    bool stopping = false;
+    std::uint64_t errors = 0;
+    latency_histogram latency;
+};
+
+class session
+{
+public:
+    session(uring &ring, load &l, std::size_t size)
+        : sock_(ring), load_(l), out_(size, 'x'), in_(size)
+    {
+    }
+
+    void start(const tcp::endpoint &endpoint)
+    {
+        sock_.open(tcp::v4());
+        int one = 1;
+        ::setsockopt(sock_.native_handle(), IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        sock_.async_connect(endpoint, [this](std::error_code ec)
+                            {
+                if (ec)
+                    return finish(ec);
+                request(); });
+    }
+
+private:
+    void request()
+    {
+        if (load_.stopping)
+            return finish({});
+
+        sent_ = std::chrono::steady_clock::now();
+        async_write(sock_, const_buffer(out_.data(), out_.size()), [this](std::error_code ec, std::size_t)
+                    {
+                if (ec)
+                    return finish(ec);
+                async_read(sock_, mutable_buffer(in_.data(), in_.size()), [this](std::error_code ec, std::size_t)
+                           {
+                        if (ec)
+                            return finish(ec);
+                        auto rtt = std::chrono::steady_clock::now() - sent_;
+                        load_.latency.record(static_cast<std::uint64_t>(rtt / std::chrono::nanoseconds(1)));
+                        request(); }); });
+    }
+
+    void finish(std::error_code ec)
+    {
+        if (ec && load_.errors++ == 0)
+            std::fprintf(stderr, "session: %s\n", ec.message().c_str());
+    }
+
+    stream_socket sock_;
+    load &load_;
+    std::vector<char> out_;
+    std::vector<char> in_;
+    std::chrono::steady_clock::time_point sent_;
+};
+
+static std::vector<std::size_t> parse_list(const char *s)
+{
+    std::vector<std::size_t> values;
+    while (*s)
+    {
+        char *end;
+        unsigned long long value = std::strtoull(s, &end, 10);
+        if (end == s)
+            break;
+        values.push_back(value);
+        s = *end == ',' ? end + 1 : end;
+    }
+    return values;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned short port = argc > 1 ? static_cast<unsigned short>(std::atoi(argv[1])) : 12345;
+    unsigned seconds = argc > 2 ? static_cast<unsigned>(std::atoi(argv[2])) : 5;
+    std::vector<std::size_t> sizes = parse_list(argc > 3 ? argv[3] : "64,1024,16384");
+    std::vector<std::size_t> conns = parse_list(argc > 4 ? argv[4] : "1,16,128");
+
+    tcp::endpoint endpoint(tcp::address_v4(), port);
+
+    std::printf("%8s %6s %12s %10s %10s %10s %10s\n", "size", "conns", "req/s", "p50(us)", "p99(us)", "p999(us)", "max(us)");
+    for (std::size_t size : sizes)
+    {
+        for (std::size_t count : conns)
+        {
+            uring ring(1024);
+            load l;
+
+            std::vector<std::unique_ptr<session>> sessions;
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                sessions.emplace_back(new session(ring, l, size));
+                sessions.back()->start(endpoint);
+            }
+
+            steady_timer timer(ring);
+            timer.expires_after(std::chrono::seconds(seconds));
+            timer.async_wait([&](std::error_code)
+                             { l.stopping = true; });
+
+            auto begin = std::chrono::steady_clock::now();
+            ring.run();
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+            std::printf("%8zu %6zu %12.0f %10.1f %10.1f %10.1f %10.1f%s\n",
+                        size, count, static_cast<double>(l.latency.count()) / elapsed,
+                        static_cast<double>(l.latency.percentile(50)) / 1e3,
+                        static_cast<double>(l.latency.percentile(99)) / 1e3,
+                        static_cast<double>(l.latency.percentile(99.9)) / 1e3,
+                        static_cast<double>(l.latency.max()) / 1e3,
+                        l.errors ? "  (errors)" : "");
+        }
+    }
+}
@@ -0,0 +1,142 @@
+// Baseline echo server on a plain epoll loop, for comparing the io_uring
+// servers against with echo_load. One edge-triggered loop per thread, each
+// with its own SO_REUSEPORT listener.
+//
+//   epoll_echo_server [port] [threads]
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static void die(const char *what)
+{
+    std::perror(what);
+    std::exit(1);
+}
+
+static int listen_on(unsigned short port)
+{
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        die("socket");
+
+    int one = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0)
+        die("bind");
+    if (::listen(fd, 128) < 0)
+        die("listen");
+    return fd;
+}
+
+// Echoes whatever is readable. A short write leaves the rest in `pending`
+// and waits for EPOLLOUT before reading more.
+struct connection
+{
+    explicit connection(int fd) : fd(fd) {}
+
+    int fd;
+    char buffer[4096];
+    std::size_t pending = 0;
+    std::size_t offset = 0;
+};
+
+static bool drain(connection &c)
+{
+    for (;;)
+    {
+        while (c.pending > 0)
+        {
+            ssize_t n = ::write(c.fd, c.buffer + c.offset, c.pending);
+            if (n < 0)
+                return errno == EAGAIN;
+            c.offset += static_cast<std::size_t>(n);
+            c.pending -= static_cast<std::size_t>(n);
+        }
+
+        ssize_t n = ::read(c.fd, c.buffer, sizeof(c.buffer));
+        if (n <= 0)
+            return n < 0 && errno == EAGAIN;
+        c.offset = 0;
+        c.pending = static_cast<std::size_t>(n);
+    }
+}
+
+static void run_loop(unsigned short port)
+{
+    int listener = listen_on(port);
+    int ep = ::epoll_create1(EPOLL_CLOEXEC);
+    if (ep < 0)
+        die("epoll_create1");
+
+    epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.ptr = nullptr;
+    if (::epoll_ctl(ep, EPOLL_CTL_ADD, listener, &ev) < 0)
+        die("epoll_ctl");
+
+    epoll_event events[256];
+    for (;;)
+    {
+        int n = ::epoll_wait(ep, events, 256, -1);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            die("epoll_wait");
+        }
+
+        for (int i = 0; i < n; ++i)
+        {
+            if (!events[i].data.ptr)
+            {
+                int fd;
+                while ((fd = ::accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0)
+                {
+                    int one = 1;
+                    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                    connection *c = new connection(fd);
+                    epoll_event cev = {};
+                    cev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+                    cev.data.ptr = c;
+                    ::epoll_ctl(ep, EPOLL_CTL_ADD, fd, &cev);
+                }
+                continue;
+            }
+
+            connection *c = static_cast<connection *>(events[i].data.ptr);
+            if (!drain(*c) || (events[i].events & (EPOLLHUP | EPOLLERR)))
+            {
+                ::close(c->fd);
+                delete c;
+            }
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    unsigned short port = argc > 1 ? static_cast<unsigned short>(std::atoi(argv[1])) : 12346;
+    unsigned threads = argc > 2 ? static_cast<unsigned>(std::atoi(argv[2])) : std::thread::hardware_concurrency();
+    if (threads == 0)
+        threads = 1;
+
+    std::vector<std::thread> loops;
+    for (unsigned i = 1; i < threads; ++i)
+        loops.emplace_back(run_loop, port);
+    run_loop(port);
+}
@@ -0,0 +1,153 @@
+// Microbenchmarks of the ring's hot paths, reported in nanoseconds per
+// operation:
+//   submit        filling and publishing a NOP SQE inside a submission_batch
+//   complete      reaping a NOP CQE and running its handler
+//   post          post() from a handler on the ring's thread to its handler
+//   post (kernel) the same through an IORING_OP_NOP round trip
+//   post (mt)     post() from another thread, per handler run
+//   create        wrapped_operation::create and completion, per allocator
+//
+//   micro [iterations]
+
+#include <ioring/uring.hpp>
+#include <ioring/post.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+using namespace ioring;
+
+using bench_clock = std::chrono::steady_clock;
+
+static void report(const char *name, bench_clock::duration elapsed, std::size_t ops)
+{
+    double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    std::printf("%-24s %10.1f ns/op %14.0f ops/s\n", name, ns / static_cast<double>(ops), static_cast<double>(ops) * 1e9 / ns);
+}
+
+struct nop_op
+{
+    explicit nop_op(std::size_t &count) : count(count) {}
+
+    void operator()(io_uring_cqe *)
+    {
+        ++count;
+    }
+
+    std::size_t &count;
+};
+
+static void bench_submit_complete(std::size_t iterations)
+{
+    const unsigned batch = 256;
+    uring ring(batch, uring::options::single_issuer());
+    ring.enable();
+
+    std::size_t done = 0;
+    bench_clock::duration submit{}, complete{};
+    for (std::size_t i = 0; i < iterations; i += batch)
+    {
+        auto t0 = bench_clock::now();
+        {
+            submission_batch b(ring);
+            for (unsigned j = 0; j < batch; ++j)
+            {
+                ring.submit([&](io_uring_sqe *sqe)
+                            {
+                        memset(sqe, 0, sizeof(*sqe));
+                        sqe->opcode = IORING_OP_NOP;
+                        sqe->user_data = wrapped_operation<nop_op>::create(ring.get_allocator(), done); });
+            }
+        }
+        auto t1 = bench_clock::now();
+        ring.run();
+        auto t2 = bench_clock::now();
+        submit += t1 - t0;
+        complete += t2 - t1;
+    }
+
+    std::size_t ops = (iterations + batch - 1) / batch * batch;
+    report("submit", submit, ops);
+    report("complete", complete, ops);
+}
+
+struct repost
+{
+    uring &ring;
+    std::size_t &left;
+    bool kernel;
+
+    void operator()(std::error_code)
+    {
+        if (--left == 0)
+            return;
+        if (kernel)
+            post(ring, kernel_round_trip, repost{ring, left, kernel});
+        else
+            post(ring, repost{ring, left, kernel});
+    }
+};
+
+static void bench_post(const char *name, bool kernel, std::size_t iterations)
+{
+    uring ring(64, uring::options::single_issuer());
+    ring.enable();
+
+    std::size_t left = iterations;
+    post(ring, repost{ring, left, kernel});
+    auto t0 = bench_clock::now();
+    ring.run();
+    report(name, bench_clock::now() - t0, iterations);
+}
+
+static void bench_post_mt(std::size_t iterations)
+{
+    uring ring(64, uring::options::single_issuer());
+    ring.enable();
+
+    std::atomic<std::size_t> done{0};
+    auto t0 = bench_clock::now();
+    std::thread producer([&]
+                         {
+            for (std::size_t i = 0; i < iterations; ++i)
+                post(ring, [&](std::error_code) { done.fetch_add(1, std::memory_order_relaxed); }); });
+    while (done.load(std::memory_order_relaxed) < iterations)
+        ring.run_for(std::chrono::milliseconds(1));
+    report("post (mt)", bench_clock::now() - t0, iterations);
+    producer.join();
+}
+
+template <typename Allocator>
+static void bench_create(const char *name, const Allocator &alloc, std::size_t iterations)
+{
+    std::size_t count = 0;
+    auto t0 = bench_clock::now();
+    for (std::size_t i = 0; i < iterations; ++i)
+    {
+        io_uring_cqe cqe = {};
+        cqe.user_data = wrapped_operation<nop_op>::create(alloc, count);
+        static_cast<operation *>(reinterpret_cast<void *>(cqe.user_data))->complete(&cqe);
+    }
+    report(name, bench_clock::now() - t0, iterations);
+    if (count != iterations)
+        std::abort();
+}
+
+int main(int argc, char **argv)
+{
+    std::size_t iterations = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+
+    bench_submit_complete(iterations);
+    bench_post("post", false, iterations);
+    bench_post("post (kernel)", true, iterations);
+    bench_post_mt(iterations);
+
+    uring ring(8);
+    bench_create("create (std::allocator)", std::allocator<void>(), iterations);
+    bench_create("create (recycling)", ring.get_allocator(), iterations);
+}
@@ -1,10 +1,13 @@
 #include <ioring/uring.hpp>
-#include <ioring/post.hpp>
+#include <ioring/uring_pool.hpp>
+#include <ioring/buffer_ring.hpp>
 #include <ioring/descriptor.hpp>
 #include <ioring/stream_descriptor.hpp>
 #include <ioring/acceptor.hpp>
+#include <ioring/sharded_acceptor.hpp>
 #include <ioring/tcp.hpp>
 
+#include <deque>
 #include <iostream>
 #include <memory>
 #include <vector>
@@ -17,12 +20,148 @@ void fail(const char *what, std::error_code ec)
     std::cerr << what << ": " << ec.message() << std::endl;
 }
 
+// Storage for the single operation a connection has outstanding at any time.
+class handler_memory
+{
+public:
+    handler_memory() = default;
+    handler_memory(const handler_memory &) = delete;
+    handler_memory &operator=(const handler_memory &) = delete;
+
+    void *allocate(std::size_t size)
+    {
+        if (!in_use_ && size <= sizeof(storage_))
+        {
+            in_use_ = true;
+            return &storage_;
+        }
+        return ::operator new(size);
+    }
+
+    void deallocate(void *p)
+    {
+        if (p == &storage_)
+            in_use_ = false;
+        else
+            ::operator delete(p);
+    }
+
+private:
+    alignas(std::max_align_t) unsigned char storage_[256];
+    bool in_use_ = false;
+};
+
+template <typename T>
+class handler_allocator
+{
+public:
+    using value_type = T;
+
+    explicit handler_allocator(handler_memory &mem)
+        : memory_(mem)
+    {
+    }
+
+    template <typename U>
+    handler_allocator(const handler_allocator<U> &other) noexcept
+        : memory_(other.memory_)
+    {
+    }
+
+    T *allocate(std::size_t n) const
+    {
+        return static_cast<T *>(memory_.allocate(sizeof(T) * n));
+    }
+
+    void deallocate(T *p, std::size_t /*n*/) const
+    {
+        return memory_.deallocate(p);
+    }
+
+    template <typename U>
+    bool operator==(const handler_allocator<U> &other) const noexcept
+    {
+        return &memory_ == &other.memory_;
+    }
+
+    template <typename U>
+    bool operator!=(const handler_allocator<U> &other) const noexcept
+    {
+        return &memory_ != &other.memory_;
+    }
+
+private:
+    template <typename>
+    friend class handler_allocator;
+
+    handler_memory &memory_;
+};
+
+template <typename Handler>
+class custom_alloc_handler
+{
+public:
+    using allocator_type = handler_allocator<Handler>;
+
+    custom_alloc_handler(handler_memory &m, Handler h)
+        : memory_(m), handler_(std::move(h))
+    {
+    }
+
+    allocator_type get_allocator() const noexcept
+    {
+        return allocator_type(memory_);
+    }
+
+    template <typename... Args>
+    void operator()(Args &&...args)
+    {
+        handler_(std::forward<Args>(args)...);
+    }
+
+private:
+    handler_memory &memory_;
+    Handler handler_;
+};
+
+template <typename Handler>
+inline custom_alloc_handler<Handler> make_custom_alloc_handler(handler_memory &m, Handler h)
+{
+    return custom_alloc_handler<Handler>(m, std::move(h));
+}
+
+class connection;
+
+// Connections whose receive ran out of buffers while holding none of them.
+// Each buffer another connection hands back re-arms one of them.
+class buffer_waiters
+{
+public:
+    void add(std::shared_ptr<connection> conn)
+    {
+        waiting_.push_back(std::move(conn));
+    }
+
+    inline void notify_one();
+
+private:
+    std::deque<std::shared_ptr<connection>> waiting_;
+};
+
 class connection : public std::enable_shared_from_this<connection>
 {
 public:
-    explicit connection(uring &ring)
-        : sock_(ring)
+    connection(uring &ring, buffer_ring &buffers, buffer_waiters &waiters)
+        : sock_(ring), buffers_(buffers), waiters_(waiters)
+    {
+    }
+
+    ~connection()
     {
+        std::size_t held = queue_.size();
+        queue_.clear();
+        for (std::size_t i = 0; i < held; ++i)
+            waiters_.notify_one();
     }
 
     stream_socket &socket()
@@ -32,110 +171,135 @@ public:
 
     void go()
     {
-        buff_.resize(8192);
-
-        sock_.async_read_some(
-            mutable_buffer(buff_.data(), buff_.size()),
-            [self = shared_from_this()](std::error_code ec, std::size_t bytes_read)
+        starved_ = false;
+        sock_.async_receive_multishot(
+            buffers_,
+            [self = shared_from_this()](std::error_code ec, buffer_lease lease)
             {
-                self->handle_read(ec, bytes_read);
+                self->handle_receive(ec, std::move(lease));
             });
     }
 
 private:
-    void handle_read(std::error_code ec, std::size_t bytes_read)
+    void handle_receive(std::error_code ec, buffer_lease lease)
     {
+        if (ec == std::errc::no_buffer_space)
+        {
+            // Wait for our own writes to hand buffers back before re-arming,
+            // or for another connection's when we hold none.
+            starved_ = true;
+            if (queue_.empty())
+                waiters_.add(shared_from_this());
+            return;
+        }
+
         if (ec)
-            return fail("read", ec);
+            return fail("receive", ec);
+
+        if (!lease)
+            return;
+
+        queue_.push_back(std::move(lease));
+        if (queue_.size() == 1)
+            write_front();
+    }
+
+    void write_front()
+    {
+        const_buffer buffer = queue_.front().buffer();
+        buffer += written_;
 
         sock_.async_write_some(
-            const_buffer(buff_.data(), bytes_read),
-            [self = shared_from_this()](std::error_code ec, std::size_t bytes_written)
-            { self->handle_write(ec, bytes_written); });
+            buffer,
+            make_custom_alloc_handler(
+                memory_,
+                [self = shared_from_this()](std::error_code ec, std::size_t bytes_written)
+                { self->handle_write(ec, bytes_written); }));
     }
 
-    void handle_write(std::error_code ec, std::size_t /*bytes_written*/)
+    void handle_write(std::error_code ec, std::size_t bytes_written)
     {
         if (ec)
             return fail("write", ec);
 
-        sock_.async_read_some(
-            mutable_buffer(buff_.data(), buff_.size()),
-            [self = shared_from_this()](std::error_code ec, std::size_t bytes_read)
-            {
-                self->handle_read(ec, bytes_read);
-            });
+        written_ += bytes_written;
+        if (written_ == queue_.front().size())
+        {
+            queue_.pop_front();
+            written_ = 0;
+            waiters_.notify_one();
+        }
+
+        if (!queue_.empty())
+            write_front();
+        else if (starved_)
+            go();
     }
 
     stream_socket sock_;
-    std::vector<char> buff_;
+    buffer_ring &buffers_;
+    buffer_waiters &waiters_;
+    std::deque<buffer_lease> queue_;
+    std::size_t written_ = 0;
+    bool starved_ = false;
+    handler_memory memory_;
 };
 
+void buffer_waiters::notify_one()
+{
+    if (waiting_.empty())
+        return;
+
+    std::shared_ptr<connection> conn = std::move(waiting_.front());
+    waiting_.pop_front();
+    conn->go();
+}
+
 class listener : public std::enable_shared_from_this<listener>
 {
 public:
-    explicit listener(uring &ring)
-        : acceptor_(ring)
+    listener(acceptor &acc, buffer_ring &buffers, buffer_waiters &waiters)
+        : acceptor_(acc), buffers_(buffers), waiters_(waiters)
     {
-        acceptor_.open(tcp::v4());
-        acceptor_.set_option(acceptor::reuse_address(true));
-        acceptor_.bind(tcp::endpoint(tcp::address_v4(), 12345));
     }
 
     void go()
     {
-        acceptor_.listen(10);
-
-        conn_ = std::make_shared<connection>(acceptor_.get_uring());
-        acceptor_.async_accept(
-            conn_->socket(), [self = shared_from_this()](std::error_code ec)
-            { self->handle_accept(ec); });
+        acceptor_.async_accept_multishot(
+            [self = shared_from_this()](std::error_code ec, int fd)
+            { self->handle_accept(ec, fd); });
     }
 
 private:
-    void handle_accept(std::error_code ec)
+    void handle_accept(std::error_code ec, int fd)
     {
         if (ec)
         {
             return fail("accept", ec);
         }
 
-        conn_->go();
-
-        conn_ = std::make_shared<connection>(acceptor_.get_uring());
-        acceptor_.async_accept(
-            conn_->socket(), [self = shared_from_this()](std::error_code ec)
-            { self->handle_accept(ec); });
+        auto conn = std::make_shared<connection>(acceptor_.get_uring(), buffers_, waiters_);
+        conn->socket().assign(fd);
+        conn->go();
     }
 
-    acceptor acceptor_;
-    std::shared_ptr<connection> conn_;
+    acceptor &acceptor_;
+    buffer_ring &buffers_;
+    buffer_waiters &waiters_;
 };
 
-void on_run(uring &ring)
-{
-    std::make_shared<listener>(ring)->go();
-}
-
 int main()
 {
-    uring ring(20);
+    uring_pool pool(std::thread::hardware_concurrency());
 
-    post(ring,
-         [&ring](std::error_code ec = {})
-         {
-             (void)ec;
-             on_run(ring);
-         });
+    std::vector<std::unique_ptr<buffer_ring>> buffers;
+    std::vector<buffer_waiters> waiters(pool.size());
+    for (std::size_t i = 0; i < pool.size(); ++i)
+        buffers.emplace_back(new buffer_ring(pool.get(i), 0, 256, 4096));
 
-    std::vector<std::thread> threads;
-    for (int i = 0; i < 1; ++i)
-    {
-        threads.emplace_back([&]
-                             { ring.run(); });
-    }
-    for (auto &t : threads)
-    {
-        t.join();
-    }
+    sharded_acceptor acceptors(pool, tcp::v4(), tcp::endpoint(tcp::address_v4(), 12345), 128);
+    for (std::size_t i = 0; i < acceptors.size(); ++i)
+        std::make_shared<listener>(acceptors[i], *buffers[i], waiters[i])->go();
+
+    pool.run();
 }
@@ -0,0 +1,59 @@
+#include <ioring/uring.hpp>
+#include <ioring/acceptor.hpp>
+#include <ioring/awaitable.hpp>
+#include <ioring/tcp.hpp>
+
+#include <iostream>
+#include <memory>
+
+using namespace ioring;
+
+task<void> write_all(stream_socket &sock, const_buffer buffer)
+{
+    while (buffer.size() > 0)
+        buffer += co_await sock.async_write_some(buffer, use_awaitable);
+}
+
+task<void> session(std::unique_ptr<stream_socket> sock)
+{
+    char data[4096];
+    try
+    {
+        for (;;)
+        {
+            std::size_t n = co_await sock->async_read_some(mutable_buffer(data, sizeof(data)), use_awaitable);
+            if (n == 0)
+                break;
+            co_await write_all(*sock, const_buffer(data, n));
+        }
+    }
+    catch (const std::system_error &e)
+    {
+        std::cerr << "session: " << e.code().message() << std::endl;
+    }
+}
+
+task<void> listener(acceptor &acc)
+{
+    for (;;)
+    {
+        auto sock = std::make_unique<stream_socket>(acc.get_uring());
+        co_await acc.async_accept(*sock, use_awaitable);
+        co_spawn(acc.get_uring(), session(std::move(sock)));
+    }
+}
+
+int main()
+{
+    uring ring(256);
+
+    acceptor acc(ring);
+    acc.open(tcp::v4());
+    acc.set_option(acceptor::reuse_address(true));
+    acc.bind(tcp::endpoint(tcp::address_v4(), 12345));
+    acc.listen(128);
+
+    co_spawn(ring, listener(acc));
+
+    ring.run();
+}
@@ -21,22 +21,83 @@ namespace ioring
         }
 
         template <typename Socket, typename Endpoint, typename Handler>
-        void async_accept(Socket &peer, Endpoint &endpoint, Handler &&handler);
+        async_return_t<Handler, void(std::error_code)> async_accept(Socket &peer, Endpoint &endpoint, Handler &&handler);
 
         template <typename Socket, typename Handler>
-        void async_accept(Socket &peer, Handler &&handler);
+        async_return_t<Handler, void(std::error_code)> async_accept(Socket &peer, Handler &&handler);
 
         template <typename Handler>
         void async_accept(Handler &&peer);
+
+        // Arms a single multishot accept. The handler is invoked as
+        // handler(std::error_code, int fd) for every accepted connection
+        // until an error is reported. The direct variant passes the
+        // registered file table slot instead of an fd.
+        template <typename Handler>
+        void async_accept_multishot(Handler &&handler);
+
+        // Variants that install accepted connections in the ring's registered
+        // file table instead of the process fd table.
+        template <typename Socket, typename Handler>
+        async_return_t<Handler, void(std::error_code)> async_accept_direct(Socket &peer, Handler &&handler);
+
+        template <typename Handler>
+        void async_accept_multishot_direct(Handler &&handler);
+
+    private:
+        template <typename Socket, typename Handler>
+        void async_accept_impl(Socket &peer, sockaddr *addr, socklen_t *addrlen, bool direct, Handler &&handler);
+
+        template <typename Handler>
+        void async_accept_multishot_impl(bool direct, Handler &&handler);
     };
 
     template <typename Socket, typename Endpoint, typename Handler>
-    void acceptor::async_accept(Socket &peer, Endpoint &endpoint, Handler &&handler)
+    async_return_t<Handler, void(std::error_code)>
+    acceptor::async_accept(Socket &peer, Endpoint &endpoint, Handler &&handler)
+    {
+        return async_initiate<void(std::error_code)>(
+            [this, &peer, &endpoint](auto &&handler)
+            {
+                using H = decltype(handler);
+                this->async_accept_impl(peer, endpoint.get(), &endpoint.size(), false, std::forward<H>(handler));
+            },
+            std::forward<Handler>(handler));
+    }
+
+    template <typename Socket, typename Handler>
+    async_return_t<Handler, void(std::error_code)>
+    acceptor::async_accept(Socket &peer, Handler &&handler)
+    {
+        return async_initiate<void(std::error_code)>(
+            [this, &peer](auto &&handler)
+            {
+                using H = decltype(handler);
+                this->async_accept_impl(peer, nullptr, nullptr, false, std::forward<H>(handler));
+            },
+            std::forward<Handler>(handler));
+    }
+
+    template <typename Socket, typename Handler>
+    async_return_t<Handler, void(std::error_code)>
+    acceptor::async_accept_direct(Socket &peer, Handler &&handler)
+    {
+        return async_initiate<void(std::error_code)>(
+            [this, &peer](auto &&handler)
+            {
+                using H = decltype(handler);
+                this->async_accept_impl(peer, nullptr, nullptr, true, std::forward<H>(handler));
+            },
+            std::forward<Handler>(handler));
+    }
+
+    template <typename Socket, typename Handler>
+    void acceptor::async_accept_impl(Socket &peer, sockaddr *addr, socklen_t *addrlen, bool direct, Handler &&handler)
     {
         struct accept_op
         {
-            accept_op(Socket &sock, Handler &&handler)
-                : sock_(sock), handler_(std::forward<Handler>(handler))
+            accept_op(Socket &sock, bool direct, Handler &&handler)
+                : sock_(sock), direct_(direct), handler_(std::forward<Handler>(handler))
             {
             }
 
@@ -48,12 +109,16 @@ namespace ioring
                 }
                 else
                 {
-                    this->sock_.assign(cqe->res);
+                    if (direct_)
+                        this->sock_.assign_direct(cqe->res);
+                    else
+                        this->sock_.assign(cqe->res);
                     handler_(std::error_code());
                 }
             }
 
             Socket &sock_;
+            bool direct_;
             typename std::decay<Handler>::type handler_;
         };
 
@@ -62,22 +127,87 @@ namespace ioring
                                          memset(sqe, 0, sizeof(*sqe));
 
                                          sqe->opcode = IORING_OP_ACCEPT;
-                                         sqe->fd = this->native_handle();
-                                         sqe->addr = reinterpret_cast<__u64>(endpoint.get());
-                                         sqe->addr2 = reinterpret_cast<__u64>(&endpoint.size());
+                                         this->prepare_fd(sqe);
+                                         sqe->addr = reinterpret_cast<__u64>(addr);
+                                         sqe->addr2 = reinterpret_cast<__u64>(addrlen);
+                                         if (direct)
+                                             sqe->file_index = IORING_FILE_INDEX_ALLOC;
+
+                                         cancellation_slot slot = get_associated_cancellation_slot(handler);
+                                         sqe->user_data = wrapped_operation<accept_op>::create(
+                                             get_associated_allocator(handler, this->get_uring().get_allocator()),
+                                             peer, direct, std::forward<Handler>(handler));
+                                         slot.assign(this->get_uring(), sqe->user_data); });
+    }
 
-                                         sqe->user_data = wrapped_operation<accept_op>::create(peer, std::forward<Handler>(handler)); });
+    template <typename Handler>
+    void acceptor::async_accept_multishot(Handler &&handler)
+    {
+        this->async_accept_multishot_impl(false, std::forward<Handler>(handler));
     }
 
-    template <typename Socket, typename Handler>
-    void acceptor::async_accept(Socket &peer, Handler &&handler)
+    template <typename Handler>
+    void acceptor::async_accept_multishot_direct(Handler &&handler)
+    {
+        this->async_accept_multishot_impl(true, std::forward<Handler>(handler));
+    }
+
+    template <typename Handler>
+    void acceptor::async_accept_multishot_impl(bool direct, Handler &&handler)
     {
-        generic_endpoint *endpoint = new generic_endpoint();
+        struct accept_op
+        {
+            accept_op(acceptor &acc, bool direct, Handler &&handler)
+                : acceptor_(acc), direct_(direct), handler_(std::forward<Handler>(handler))
+            {
+            }
+
+            static void prepare(io_uring_sqe *sqe, const acceptor &acc, bool direct)
+            {
+                memset(sqe, 0, sizeof(*sqe));
+                sqe->opcode = IORING_OP_ACCEPT;
+                acc.prepare_fd(sqe);
+                sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+                if (direct)
+                    sqe->file_index = IORING_FILE_INDEX_ALLOC;
+            }
+
+            bool operator()(io_uring_cqe *cqe)
+            {
+                if (cqe->res < 0)
+                {
+                    handler_(std::error_code(-cqe->res, std::system_category()), -1);
+                    return false;
+                }
 
-        this->async_accept(peer, *endpoint, [h = std::forward<Handler>(handler), endpoint](std::error_code ec)
-                           {
-                delete endpoint;
-                h(ec); });
+                // The kernel ended the multishot stream without an error;
+                // re-arm it in place before handing out the socket.
+                bool rearmed = false;
+                if (!(cqe->flags & IORING_CQE_F_MORE))
+                {
+                    __u64 user_data = cqe->user_data;
+                    acceptor_.get_uring().submit([&](io_uring_sqe *sqe)
+                                                 {
+                            prepare(sqe, acceptor_, direct_);
+                            sqe->user_data = user_data; });
+                    rearmed = true;
+                }
+
+                handler_(std::error_code(), cqe->res);
+                return rearmed;
+            }
+
+            acceptor &acceptor_;
+            bool direct_;
+            typename std::decay<Handler>::type handler_;
+        };
+
+        this->get_uring().submit([&](io_uring_sqe *sqe)
+                                 {
+                accept_op::prepare(sqe, *this, direct);
+                sqe->user_data = multishot_operation<accept_op>::create(
+                    get_associated_allocator(handler, this->get_uring().get_allocator()),
+                    *this, direct, std::forward<Handler>(handler)); });
     }
 
     // template <typename Handler>
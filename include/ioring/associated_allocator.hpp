@@ -0,0 +1,42 @@
+#ifndef IORING_ASSOCIATED_ALLOCATOR_HPP
+#define IORING_ASSOCIATED_ALLOCATOR_HPP
+
+#include <type_traits>
+
+namespace ioring
+{
+
+    // A handler opts in to custom operation storage by exposing an
+    // allocator_type typedef and a get_allocator() member.
+    template <typename T, typename Default, typename = void>
+    struct associated_allocator
+    {
+        using type = Default;
+
+        static type get(const T &, const Default &d) noexcept
+        {
+            return d;
+        }
+    };
+
+    template <typename T, typename Default>
+    struct associated_allocator<T, Default, std::void_t<typename T::allocator_type>>
+    {
+        using type = typename T::allocator_type;
+
+        static type get(const T &t, const Default &) noexcept
+        {
+            return t.get_allocator();
+        }
+    };
+
+    template <typename T, typename Default>
+    typename associated_allocator<T, Default>::type
+    get_associated_allocator(const T &t, const Default &d) noexcept
+    {
+        return associated_allocator<T, Default>::get(t, d);
+    }
+
+}
+
+#endif /* IORING_ASSOCIATED_ALLOCATOR_HPP */
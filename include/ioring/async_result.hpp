@@ -0,0 +1,42 @@
+#ifndef IORING_ASYNC_RESULT_HPP
+#define IORING_ASYNC_RESULT_HPP
+
+#include <type_traits>
+#include <utility>
+
+namespace ioring
+{
+
+    // Decides what an async operation returns for a completion token of
+    // type Token and a completion signature such as
+    // void(std::error_code, std::size_t). The primary template treats the
+    // token as a handler: the operation starts immediately and returns void.
+    // Tokens like use_awaitable specialise it to defer the initiation.
+    template <typename Token, typename Signature>
+    struct async_result
+    {
+        using return_type = void;
+
+        template <typename Initiation, typename T>
+        static void initiate(Initiation &&initiation, T &&token)
+        {
+            std::forward<Initiation>(initiation)(std::forward<T>(token));
+        }
+    };
+
+    template <typename Token, typename Signature>
+    using async_return_t = typename async_result<typename std::decay<Token>::type, Signature>::return_type;
+
+    // Starts an operation through async_result. `initiation` is called with
+    // the final handler and must not keep references to the caller's
+    // temporaries beyond the full-expression.
+    template <typename Signature, typename Token, typename Initiation>
+    async_return_t<Token, Signature> async_initiate(Initiation &&initiation, Token &&token)
+    {
+        return async_result<typename std::decay<Token>::type, Signature>::initiate(
+            std::forward<Initiation>(initiation), std::forward<Token>(token));
+    }
+
+}
+
+#endif /* IORING_ASYNC_RESULT_HPP */
@@ -0,0 +1,610 @@
+#ifndef IORING_AWAITABLE_HPP
+#define IORING_AWAITABLE_HPP
+
+#include <ioring/config.hpp>
+
+#if IORING_HAS_CO_AWAIT
+
+#include <ioring/uring.hpp>
+#include <ioring/async_result.hpp>
+#include <ioring/post.hpp>
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <new>
+#include <optional>
+#include <system_error>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace ioring
+{
+
+    // Completion token turning an async operation into an awaitable:
+    //
+    //     std::size_t n = co_await sock.async_read_some(buf, use_awaitable);
+    //
+    // The operation starts when awaited. A leading std::error_code result is
+    // thrown as std::system_error; the remaining results are returned.
+    struct use_awaitable_t
+    {
+        constexpr use_awaitable_t() noexcept = default;
+    };
+
+    inline constexpr use_awaitable_t use_awaitable{};
+
+    // Storage inside the awaiter for the operation an awaited initiation
+    // creates. The awaiter lives in the coroutine frame, so the operation
+    // needs no allocation of its own; oversized ones go to the heap.
+    class awaitable_storage
+    {
+    public:
+        static constexpr std::size_t size = 128;
+
+        awaitable_storage() noexcept = default;
+
+        awaitable_storage(const awaitable_storage &) = delete;
+        awaitable_storage &operator=(const awaitable_storage &) = delete;
+
+        void *allocate(std::size_t n, std::size_t align)
+        {
+            if (!used_ && n <= size && align <= alignof(std::max_align_t))
+            {
+                used_ = true;
+                return data_;
+            }
+            return ::operator new(n, std::align_val_t(align));
+        }
+
+        void deallocate(void *p, std::size_t, std::size_t align) noexcept
+        {
+            if (p == data_)
+            {
+                used_ = false;
+                return;
+            }
+            ::operator delete(p, std::align_val_t(align));
+        }
+
+    private:
+        alignas(std::max_align_t) unsigned char data_[size];
+        bool used_ = false;
+    };
+
+    template <typename T>
+    class awaitable_allocator
+    {
+    public:
+        using value_type = T;
+
+        template <typename U>
+        struct rebind
+        {
+            using other = awaitable_allocator<U>;
+        };
+
+        explicit awaitable_allocator(awaitable_storage &storage) noexcept
+            : storage_(&storage)
+        {
+        }
+
+        template <typename U>
+        awaitable_allocator(const awaitable_allocator<U> &other) noexcept
+            : storage_(other.storage_)
+        {
+        }
+
+        T *allocate(std::size_t n)
+        {
+            return static_cast<T *>(storage_->allocate(sizeof(T) * n, alignof(T)));
+        }
+
+        void deallocate(T *p, std::size_t n) noexcept
+        {
+            storage_->deallocate(p, sizeof(T) * n, alignof(T));
+        }
+
+        template <typename U>
+        bool operator==(const awaitable_allocator<U> &other) const noexcept
+        {
+            return storage_ == other.storage_;
+        }
+
+        template <typename U>
+        bool operator!=(const awaitable_allocator<U> &other) const noexcept
+        {
+            return storage_ != other.storage_;
+        }
+
+    private:
+        template <typename U>
+        friend class awaitable_allocator;
+
+        awaitable_storage *storage_;
+    };
+
+    // Exception that escaped a coroutine started by co_spawn, held while
+    // its frame is destroyed and rethrown by the code that resumed it.
+    inline std::exception_ptr &spawn_exception() noexcept
+    {
+        static thread_local std::exception_ptr e;
+        return e;
+    }
+
+    inline void resume_coroutine(std::coroutine_handle<> coro)
+    {
+        coro.resume();
+        if (spawn_exception())
+            std::rethrow_exception(std::exchange(spawn_exception(), nullptr));
+    }
+
+    template <typename... Results>
+    struct awaitable_state
+    {
+        std::coroutine_handle<> coro;
+        std::optional<std::tuple<Results...>> results;
+        awaitable_storage storage;
+    };
+
+    // Handler passed to the initiation of an awaited operation: stores the
+    // results in the awaiter and resumes the coroutine.
+    template <typename... Results>
+    class awaitable_handler
+    {
+    public:
+        using allocator_type = awaitable_allocator<void>;
+
+        explicit awaitable_handler(awaitable_state<Results...> *state) noexcept
+            : state_(state)
+        {
+        }
+
+        allocator_type get_allocator() const noexcept
+        {
+            return allocator_type(state_->storage);
+        }
+
+        template <typename... Args>
+        void operator()(Args &&...args)
+        {
+            state_->results.emplace(std::forward<Args>(args)...);
+            resume_coroutine(state_->coro);
+        }
+
+    private:
+        awaitable_state<Results...> *state_;
+    };
+
+    // Awaiter returned by operations started with use_awaitable. The
+    // initiation captures the object and the operation's arguments by
+    // value; it is stored in place unless it is larger than
+    // initiation_size.
+    template <typename... Results>
+    class awaitable_operation
+        : awaitable_state<Results...>
+    {
+    public:
+        static constexpr std::size_t initiation_size = 64;
+
+        template <typename Initiation>
+        explicit awaitable_operation(Initiation &&initiation)
+        {
+            using init_type = typename std::decay<Initiation>::type;
+            if constexpr (sizeof(init_type) <= initiation_size && alignof(init_type) <= alignof(std::max_align_t))
+            {
+                ::new (static_cast<void *>(init_)) init_type(std::forward<Initiation>(initiation));
+                start_ = [](void *init, awaitable_state<Results...> *state)
+                {
+                    // The handler may resume, and so destroy, the awaiter
+                    // before the initiation returns: run it from the stack.
+                    init_type local(std::move(*static_cast<init_type *>(init)));
+                    static_cast<init_type *>(init)->~init_type();
+                    local(awaitable_handler<Results...>(state));
+                };
+                destroy_ = [](void *init) noexcept
+                {
+                    static_cast<init_type *>(init)->~init_type();
+                };
+            }
+            else
+            {
+                // Initiations holding a copied endpoint and the like do not
+                // fit in place and are kept on the heap instead.
+                ::new (static_cast<void *>(init_)) init_type *(new init_type(std::forward<Initiation>(initiation)));
+                start_ = [](void *init, awaitable_state<Results...> *state)
+                {
+                    std::unique_ptr<init_type> local(*static_cast<init_type **>(init));
+                    (*local)(awaitable_handler<Results...>(state));
+                };
+                destroy_ = [](void *init) noexcept
+                {
+                    delete *static_cast<init_type **>(init);
+                };
+            }
+        }
+
+        awaitable_operation(const awaitable_operation &) = delete;
+        awaitable_operation &operator=(const awaitable_operation &) = delete;
+
+        ~awaitable_operation()
+        {
+            if (destroy_)
+                destroy_(init_);
+        }
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> coro)
+        {
+            this->coro = coro;
+            auto start = start_;
+            destroy_ = nullptr;
+            start(init_, this);
+        }
+
+        auto await_resume()
+        {
+            return unpack(std::move(*this->results));
+        }
+
+    private:
+        template <typename... Ts>
+        static auto unpack(std::tuple<std::error_code, Ts...> &&results)
+        {
+            if (std::get<0>(results))
+                throw std::system_error(std::get<0>(results));
+
+            if constexpr (sizeof...(Ts) == 0)
+                return;
+            else if constexpr (sizeof...(Ts) == 1)
+                return std::move(std::get<1>(results));
+            else
+                return std::apply([](std::error_code, Ts &&...ts)
+                                  { return std::tuple<Ts...>(std::move(ts)...); },
+                                  std::move(results));
+        }
+
+        alignas(std::max_align_t) unsigned char init_[initiation_size];
+        void (*start_)(void *, awaitable_state<Results...> *) = nullptr;
+        void (*destroy_)(void *) noexcept = nullptr;
+    };
+
+    template <typename R, typename... Results>
+    struct async_result<use_awaitable_t, R(Results...)>
+    {
+        using return_type = awaitable_operation<typename std::decay<Results>::type...>;
+
+        template <typename Initiation, typename T>
+        static return_type initiate(Initiation &&initiation, T &&)
+        {
+            return return_type(std::forward<Initiation>(initiation));
+        }
+    };
+
+    // Coroutine frames are taken from the operation pool of the ring running
+    // on the allocating thread, if any. The pool is recorded in front of the
+    // frame; frames must be freed on the same thread.
+    struct coroutine_frame_allocation
+    {
+        static constexpr std::size_t header = alignof(std::max_align_t);
+
+        static void *operator new(std::size_t size)
+        {
+            uring *ring = uring::current_ring();
+            operation_pool *pool = ring ? &ring->get_allocator().pool() : nullptr;
+            void *p = pool ? pool->allocate(size + header, header) : ::operator new(size + header);
+            *static_cast<operation_pool **>(p) = pool;
+            return static_cast<char *>(p) + header;
+        }
+
+        static void operator delete(void *frame, std::size_t size) noexcept
+        {
+            void *p = static_cast<char *>(frame) - header;
+            operation_pool *pool = *static_cast<operation_pool **>(p);
+            if (pool)
+                pool->deallocate(p, size + header, header);
+            else
+                ::operator delete(p);
+        }
+    };
+
+    template <typename T = void>
+    class task;
+
+    class task_promise_base
+        : public coroutine_frame_allocation
+    {
+    public:
+        struct final_awaiter
+        {
+            bool await_ready() const noexcept
+            {
+                return false;
+            }
+
+            template <typename Promise>
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> coro) noexcept
+            {
+                std::coroutine_handle<> continuation = coro.promise().continuation_;
+                return continuation ? continuation : std::noop_coroutine();
+            }
+
+            void await_resume() const noexcept
+            {
+            }
+        };
+
+        std::suspend_always initial_suspend() const noexcept
+        {
+            return {};
+        }
+
+        final_awaiter final_suspend() const noexcept
+        {
+            return {};
+        }
+
+        void unhandled_exception() noexcept
+        {
+            exception_ = std::current_exception();
+        }
+
+    protected:
+        template <typename T>
+        friend class task;
+
+        std::coroutine_handle<> continuation_;
+        std::exception_ptr exception_;
+    };
+
+    template <typename T>
+    class task_promise
+        : public task_promise_base
+    {
+    public:
+        inline task<T> get_return_object() noexcept;
+
+        template <typename U>
+        void return_value(U &&value)
+        {
+            value_.emplace(std::forward<U>(value));
+        }
+
+        T result()
+        {
+            if (exception_)
+                std::rethrow_exception(exception_);
+            return std::move(*value_);
+        }
+
+    private:
+        std::optional<T> value_;
+    };
+
+    template <>
+    class task_promise<void>
+        : public task_promise_base
+    {
+    public:
+        inline task<void> get_return_object() noexcept;
+
+        void return_void() const noexcept
+        {
+        }
+
+        void result()
+        {
+            if (exception_)
+                std::rethrow_exception(exception_);
+        }
+    };
+
+    // Lazily started coroutine. Awaiting a task starts it and transfers
+    // control back to the awaiting coroutine, without growing the stack,
+    // when it finishes.
+    template <typename T>
+    class task
+    {
+    public:
+        using promise_type = task_promise<T>;
+        using handle_type = std::coroutine_handle<promise_type>;
+
+        task(task &&other) noexcept
+            : coro_(std::exchange(other.coro_, nullptr))
+        {
+        }
+
+        task &operator=(task &&other) noexcept
+        {
+            if (this != &other)
+            {
+                if (coro_)
+                    coro_.destroy();
+                coro_ = std::exchange(other.coro_, nullptr);
+            }
+            return *this;
+        }
+
+        ~task()
+        {
+            if (coro_)
+                coro_.destroy();
+        }
+
+        auto operator co_await() && noexcept
+        {
+            struct awaiter
+            {
+                handle_type coro;
+
+                bool await_ready() const noexcept
+                {
+                    return false;
+                }
+
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<> continuation) noexcept
+                {
+                    coro.promise().continuation_ = continuation;
+                    return coro;
+                }
+
+                T await_resume()
+                {
+                    return coro.promise().result();
+                }
+            };
+            return awaiter{coro_};
+        }
+
+    private:
+        friend class task_promise<T>;
+
+        explicit task(handle_type coro) noexcept
+            : coro_(coro)
+        {
+        }
+
+        handle_type coro_;
+    };
+
+    template <typename T>
+    task<T> task_promise<T>::get_return_object() noexcept
+    {
+        return task<T>(task<T>::handle_type::from_promise(*this));
+    }
+
+    task<void> task_promise<void>::get_return_object() noexcept
+    {
+        return task<void>(task<void>::handle_type::from_promise(*this));
+    }
+
+    // Top-level coroutine started by co_spawn; destroys itself on return.
+    // An exception leaving it is handed to spawn_exception() once the frame
+    // is gone.
+    struct spawned_coroutine
+    {
+        struct promise_type
+            : coroutine_frame_allocation
+        {
+            struct final_awaiter
+            {
+                bool await_ready() const noexcept
+                {
+                    return false;
+                }
+
+                void await_suspend(std::coroutine_handle<promise_type> coro) const noexcept
+                {
+                    std::exception_ptr e = std::move(coro.promise().exception_);
+                    coro.destroy();
+                    if (e)
+                        spawn_exception() = std::move(e);
+                }
+
+                void await_resume() const noexcept
+                {
+                }
+            };
+
+            spawned_coroutine get_return_object() noexcept
+            {
+                return spawned_coroutine{std::coroutine_handle<promise_type>::from_promise(*this)};
+            }
+
+            std::suspend_always initial_suspend() const noexcept
+            {
+                return {};
+            }
+
+            final_awaiter final_suspend() const noexcept
+            {
+                return {};
+            }
+
+            void return_void() const noexcept
+            {
+            }
+
+            void unhandled_exception() noexcept
+            {
+                exception_ = std::current_exception();
+            }
+
+            std::exception_ptr exception_;
+        };
+
+        std::coroutine_handle<promise_type> coro;
+    };
+
+    template <typename T, typename Handler>
+    spawned_coroutine co_spawn_entry(task<T> t, Handler handler)
+    {
+        std::exception_ptr e;
+        if constexpr (std::is_void<T>::value)
+        {
+            try
+            {
+                co_await std::move(t);
+            }
+            catch (...)
+            {
+                e = std::current_exception();
+            }
+            handler(e);
+        }
+        else
+        {
+            std::optional<T> value;
+            try
+            {
+                value.emplace(co_await std::move(t));
+            }
+            catch (...)
+            {
+                e = std::current_exception();
+            }
+            handler(e, value ? std::move(*value) : T());
+        }
+    }
+
+    // Starts `t` on the thread running the ring. When it finishes, the
+    // handler is invoked as handler(std::exception_ptr) for task<void>, or
+    // handler(std::exception_ptr, T) otherwise.
+    template <typename T, typename Handler>
+    void co_spawn(uring &ring, task<T> t, Handler &&handler)
+    {
+        spawned_coroutine entry = co_spawn_entry(std::move(t), typename std::decay<Handler>::type(std::forward<Handler>(handler)));
+        try
+        {
+            post(ring, [coro = entry.coro](std::error_code)
+                 { resume_coroutine(coro); });
+        }
+        catch (...)
+        {
+            entry.coro.destroy();
+            throw;
+        }
+    }
+
+    // Detached variant: an exception escaping the task propagates out of
+    // uring::run() once the coroutine's frame has been destroyed.
+    template <typename T>
+    void co_spawn(uring &ring, task<T> t)
+    {
+        co_spawn(ring, std::move(t), [](std::exception_ptr e, auto &&...)
+                 {
+                if (e)
+                    std::rethrow_exception(e); });
+    }
+
+}
+
+#endif /* IORING_HAS_CO_AWAIT */
+
+#endif /* IORING_AWAITABLE_HPP */
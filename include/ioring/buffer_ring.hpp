@@ -0,0 +1,146 @@
+#ifndef IORING_BUFFER_RING_HPP
+#define IORING_BUFFER_RING_HPP
+
+#include <ioring/uring.hpp>
+#include <ioring/buffers.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace ioring
+{
+
+    // A group of equally sized buffers handed to the kernel through
+    // IORING_REGISTER_PBUF_RING. Receives submitted with IOSQE_BUFFER_SELECT
+    // pick a buffer from the group only when data actually arrives.
+    class buffer_ring
+    {
+    public:
+        IORING_DECL buffer_ring(uring &ring, __u16 group_id, unsigned entries, std::size_t buffer_size);
+
+        IORING_DECL ~buffer_ring();
+
+        buffer_ring(const buffer_ring &) = delete;
+        buffer_ring &operator=(const buffer_ring &) = delete;
+
+        __u16 group_id() const noexcept
+        {
+            return group_id_;
+        }
+
+        unsigned entries() const noexcept
+        {
+            return entries_;
+        }
+
+        std::size_t buffer_size() const noexcept
+        {
+            return buffer_size_;
+        }
+
+        mutable_buffer buffer(__u16 id) const noexcept
+        {
+            return mutable_buffer(storage_.get() + id * buffer_size_, buffer_size_);
+        }
+
+        // Gives buffer `id` back to the kernel.
+        void recycle(__u16 id) noexcept
+        {
+            io_uring_buf *buf = &bufs_[tail_ & (entries_ - 1)];
+            buf->addr = reinterpret_cast<__u64>(storage_.get() + id * buffer_size_);
+            buf->len = static_cast<__u32>(buffer_size_);
+            buf->bid = id;
+            ++tail_;
+            tail_ptr_->store(tail_, std::memory_order_release);
+        }
+
+    private:
+        uring &ring_;
+        __u16 group_id_;
+        unsigned entries_;
+        std::size_t buffer_size_;
+        void *ring_ptr_;
+        io_uring_buf *bufs_;
+        std::atomic<__u16> *tail_ptr_;
+        __u16 tail_;
+        std::unique_ptr<char[]> storage_;
+    };
+
+    // Ownership of one provided buffer filled by the kernel. The buffer goes
+    // back to its ring when the lease is released or destroyed.
+    class buffer_lease
+    {
+    public:
+        buffer_lease() noexcept
+            : ring_(nullptr), id_(0), size_(0)
+        {
+        }
+
+        buffer_lease(buffer_ring &ring, __u16 id, std::size_t size) noexcept
+            : ring_(&ring), id_(id), size_(size)
+        {
+        }
+
+        buffer_lease(buffer_lease &&other) noexcept
+            : ring_(std::exchange(other.ring_, nullptr)), id_(other.id_), size_(other.size_)
+        {
+        }
+
+        buffer_lease &operator=(buffer_lease &&other) noexcept
+        {
+            if (this != &other)
+            {
+                release();
+                ring_ = std::exchange(other.ring_, nullptr);
+                id_ = other.id_;
+                size_ = other.size_;
+            }
+            return *this;
+        }
+
+        ~buffer_lease()
+        {
+            release();
+        }
+
+        void release() noexcept
+        {
+            if (ring_)
+            {
+                ring_->recycle(id_);
+                ring_ = nullptr;
+            }
+        }
+
+        explicit operator bool() const noexcept
+        {
+            return ring_ != nullptr;
+        }
+
+        char *data() const noexcept
+        {
+            return ring_ ? static_cast<char *>(ring_->buffer(id_).data()) : nullptr;
+        }
+
+        std::size_t size() const noexcept
+        {
+            return ring_ ? size_ : 0;
+        }
+
+        const_buffer buffer() const noexcept
+        {
+            return const_buffer(data(), size());
+        }
+
+    private:
+        buffer_ring *ring_;
+        __u16 id_;
+        std::size_t size_;
+    };
+
+}
+
+#include <ioring/impl/buffer_ring.ipp>
+
+#endif /* IORING_BUFFER_RING_HPP */
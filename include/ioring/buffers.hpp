@@ -1,6 +1,11 @@
 #ifndef IORING_BUFFERS_HPP
 #define IORING_BUFFERS_HPP
 
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
 #include <sys/uio.h>
 
 namespace ioring
@@ -75,6 +80,116 @@ namespace ioring
         size_t size_;
     };
 
+    // A slice of a buffer registered with uring::register_buffers. Reads and
+    // writes through a registered buffer use IORING_OP_READ_FIXED and
+    // IORING_OP_WRITE_FIXED, sparing the kernel from pinning the pages on
+    // every operation.
+    class mutable_registered_buffer : public mutable_buffer
+    {
+    public:
+        mutable_registered_buffer(void *data, size_t size, unsigned index) noexcept
+            : mutable_buffer(data, size), index_(index)
+        {
+        }
+
+        unsigned buffer_index() const noexcept
+        {
+            return index_;
+        }
+
+    private:
+        unsigned index_;
+    };
+
+    class const_registered_buffer : public const_buffer
+    {
+    public:
+        const_registered_buffer(const void *data, size_t size, unsigned index) noexcept
+            : const_buffer(data, size), index_(index)
+        {
+        }
+
+        const_registered_buffer(mutable_registered_buffer buffer) noexcept
+            : const_buffer(buffer.data(), buffer.size()), index_(buffer.buffer_index())
+        {
+        }
+
+        unsigned buffer_index() const noexcept
+        {
+            return index_;
+        }
+
+    private:
+        unsigned index_;
+    };
+
+    // A buffer sequence is a single buffer or a range of them, such as
+    // std::array<const_buffer, 2>{header, body} or std::vector<mutable_buffer>.
+    inline const mutable_buffer *buffer_sequence_begin(const mutable_buffer &buffer) noexcept
+    {
+        return &buffer;
+    }
+
+    inline const mutable_buffer *buffer_sequence_end(const mutable_buffer &buffer) noexcept
+    {
+        return &buffer + 1;
+    }
+
+    inline const const_buffer *buffer_sequence_begin(const const_buffer &buffer) noexcept
+    {
+        return &buffer;
+    }
+
+    inline const const_buffer *buffer_sequence_end(const const_buffer &buffer) noexcept
+    {
+        return &buffer + 1;
+    }
+
+    template <typename Buffers>
+    auto buffer_sequence_begin(const Buffers &buffers) noexcept -> decltype(std::begin(buffers))
+    {
+        return std::begin(buffers);
+    }
+
+    template <typename Buffers>
+    auto buffer_sequence_end(const Buffers &buffers) noexcept -> decltype(std::end(buffers))
+    {
+        return std::end(buffers);
+    }
+
+    template <typename T, typename = void>
+    struct is_mutable_buffer_sequence : std::false_type
+    {
+    };
+
+    template <typename T>
+    struct is_mutable_buffer_sequence<T, typename std::enable_if<std::is_convertible<
+                                             decltype(*buffer_sequence_begin(std::declval<const T &>())),
+                                             mutable_buffer>::value>::type> : std::true_type
+    {
+    };
+
+    template <typename T, typename = void>
+    struct is_const_buffer_sequence : std::false_type
+    {
+    };
+
+    template <typename T>
+    struct is_const_buffer_sequence<T, typename std::enable_if<std::is_convertible<
+                                           decltype(*buffer_sequence_begin(std::declval<const T &>())),
+                                           const_buffer>::value>::type> : std::true_type
+    {
+    };
+
+    template <typename Buffers>
+    std::size_t buffer_size(const Buffers &buffers) noexcept
+    {
+        std::size_t size = 0;
+        for (auto i = buffer_sequence_begin(buffers), e = buffer_sequence_end(buffers); i != e; ++i)
+            size += const_buffer(*i).size();
+        return size;
+    }
+
 }
 
 #endif /* IORING_BUFFERS_HPP */
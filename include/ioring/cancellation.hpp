@@ -0,0 +1,188 @@
+#ifndef IORING_CANCELLATION_HPP
+#define IORING_CANCELLATION_HPP
+
+#include <ioring/uring.hpp>
+#include <ioring/associated_allocator.hpp>
+
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+namespace ioring
+{
+
+    class cancellation_slot;
+
+    // Source of cancellation requests. The operation attached through the
+    // signal's slot is cancelled by user_data with IORING_OP_ASYNC_CANCEL;
+    // it then completes with std::errc::operation_canceled unless it has
+    // already finished. Must be used on the thread running the ring and
+    // outlive any operation attached to its slot.
+    class cancellation_signal
+    {
+    public:
+        cancellation_signal() noexcept = default;
+
+        cancellation_signal(const cancellation_signal &) = delete;
+        cancellation_signal &operator=(const cancellation_signal &) = delete;
+
+        inline cancellation_slot slot() noexcept;
+
+        void emit()
+        {
+            if (!ring_)
+                return;
+
+            uring &ring = *ring_;
+            __u64 target = user_data_;
+            ring_ = nullptr;
+
+            ring.submit_detached(detached_op::cancel, -1, [&](io_uring_sqe *sqe)
+                                 {
+                    memset(sqe, 0, sizeof(*sqe));
+                    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+                    sqe->addr = target; });
+        }
+
+    private:
+        friend class cancellation_slot;
+
+        uring *ring_ = nullptr;
+        __u64 user_data_ = 0;
+    };
+
+    // Cheap handle to a cancellation_signal. Async operations record
+    // themselves in the slot associated with their handler; the slot is
+    // cleared again when that handler is invoked.
+    class cancellation_slot
+    {
+    public:
+        cancellation_slot() noexcept = default;
+
+        explicit cancellation_slot(cancellation_signal *signal) noexcept
+            : signal_(signal)
+        {
+        }
+
+        bool is_connected() const noexcept
+        {
+            return signal_ != nullptr;
+        }
+
+        bool has_operation() const noexcept
+        {
+            return signal_ && signal_->ring_;
+        }
+
+        void assign(uring &ring, __u64 user_data) noexcept
+        {
+            if (!signal_)
+                return;
+            signal_->ring_ = &ring;
+            signal_->user_data_ = user_data;
+        }
+
+        void clear() noexcept
+        {
+            if (signal_)
+                signal_->ring_ = nullptr;
+        }
+
+    private:
+        cancellation_signal *signal_ = nullptr;
+    };
+
+    cancellation_slot cancellation_signal::slot() noexcept
+    {
+        return cancellation_slot(this);
+    }
+
+    // A handler opts in to cancellation by exposing a cancellation_slot_type
+    // typedef and a get_cancellation_slot() member.
+    template <typename T, typename = void>
+    struct associated_cancellation_slot
+    {
+        using type = cancellation_slot;
+
+        static type get(const T &) noexcept
+        {
+            return cancellation_slot();
+        }
+    };
+
+    template <typename T>
+    struct associated_cancellation_slot<T, std::void_t<typename T::cancellation_slot_type>>
+    {
+        using type = typename T::cancellation_slot_type;
+
+        static type get(const T &t) noexcept
+        {
+            return t.get_cancellation_slot();
+        }
+    };
+
+    template <typename T>
+    typename associated_cancellation_slot<T>::type
+    get_associated_cancellation_slot(const T &t) noexcept
+    {
+        return associated_cancellation_slot<T>::get(t);
+    }
+
+    template <typename Handler>
+    class cancellation_slot_binder
+    {
+    public:
+        using cancellation_slot_type = cancellation_slot;
+
+        template <typename H>
+        cancellation_slot_binder(cancellation_slot slot, H &&h)
+            : slot_(slot), handler_(std::forward<H>(h))
+        {
+        }
+
+        cancellation_slot get_cancellation_slot() const noexcept
+        {
+            return slot_;
+        }
+
+        const Handler &get() const noexcept
+        {
+            return handler_;
+        }
+
+        template <typename... Args>
+        void operator()(Args &&...args)
+        {
+            slot_.clear();
+            handler_(std::forward<Args>(args)...);
+        }
+
+    private:
+        cancellation_slot slot_;
+        Handler handler_;
+    };
+
+    // The binder keeps the allocator associated with the wrapped handler.
+    template <typename Handler, typename Default>
+    struct associated_allocator<cancellation_slot_binder<Handler>, Default>
+    {
+        using type = typename associated_allocator<Handler, Default>::type;
+
+        static type get(const cancellation_slot_binder<Handler> &b, const Default &d) noexcept
+        {
+            return associated_allocator<Handler, Default>::get(b.get(), d);
+        }
+    };
+
+    // Attaches `slot` to the single-shot operation started with the returned
+    // handler. Multishot operations are stopped with descriptor::cancel().
+    template <typename Handler>
+    cancellation_slot_binder<typename std::decay<Handler>::type>
+    bind_cancellation_slot(cancellation_slot slot, Handler &&handler)
+    {
+        return cancellation_slot_binder<typename std::decay<Handler>::type>(slot, std::forward<Handler>(handler));
+    }
+
+}
+
+#endif /* IORING_CANCELLATION_HPP */
@@ -3,4 +3,34 @@
 
 #define IORING_DECL inline
 
+// C++20 coroutine support (<ioring/awaitable.hpp>).
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L && defined(__has_include)
+#if __has_include(<coroutine>)
+#define IORING_HAS_CO_AWAIT 1
+#endif
+#endif
+
+#ifndef IORING_HAS_CO_AWAIT
+#define IORING_HAS_CO_AWAIT 0
+#endif
+
+// Per-ring counters and latency histograms (<ioring/stats.hpp>), read
+// through uring::stats(). Off by default; costs a clock read per flush
+// and per reaped CQE when on.
+#ifndef IORING_ENABLE_STATS
+#define IORING_ENABLE_STATS 0
+#endif
+
+// Per-ring trace of operation creation, submission and completion
+// (<ioring/trace.hpp>), read through uring::trace(). Off by default; no
+// hook is compiled in then.
+#ifndef IORING_ENABLE_TRACING
+#define IORING_ENABLE_TRACING 0
+#endif
+
+// Events a ring's trace buffer keeps before overwriting the oldest.
+#ifndef IORING_TRACE_CAPACITY
+#define IORING_TRACE_CAPACITY 65536
+#endif
+
 #endif /* IORING_CONFIG_HPP */
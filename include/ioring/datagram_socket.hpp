@@ -0,0 +1,403 @@
+#ifndef IORING_DATAGRAM_SOCKET_HPP
+#define IORING_DATAGRAM_SOCKET_HPP
+
+#include <ioring/socket_base.hpp>
+#include <ioring/buffers.hpp>
+#include <ioring/buffer_ring.hpp>
+#include <ioring/vectored.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <sys/socket.h>
+
+namespace ioring
+{
+
+    // The iovecs, peer address and UDP cmsg of a sendmsg or recvmsg. The
+    // kernel may read them until the operation completes.
+    struct message_state
+        : iovec_state
+    {
+        template <typename Buffers>
+        explicit message_state(const Buffers &buffers) noexcept
+            : iovec_state(buffers)
+        {
+        }
+
+        void set_name(const sockaddr *name, socklen_t length) noexcept
+        {
+            memcpy(&address, name, length);
+            msg.msg_name = &address;
+            msg.msg_namelen = length;
+        }
+
+        void receive_name() noexcept
+        {
+            msg.msg_name = &address;
+            msg.msg_namelen = sizeof(address);
+        }
+
+        // Asks for generic segmentation offload of this send.
+        void set_segment_size(std::uint16_t size) noexcept
+        {
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+            cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+            cmsg->cmsg_level = SOL_UDP;
+            cmsg->cmsg_type = UDP_SEGMENT;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(size));
+            memcpy(CMSG_DATA(cmsg), &size, sizeof(size));
+        }
+
+        sockaddr_storage address;
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(std::uint16_t))];
+    };
+
+    template <typename Op>
+    struct message_op
+        : message_state
+    {
+        template <typename Buffers, typename... Args>
+        explicit message_op(const Buffers &buffers, Args &&...args)
+            : message_state(buffers), op(std::forward<Args>(args)...)
+        {
+        }
+
+        void operator()(io_uring_cqe *cqe)
+        {
+            op(cqe);
+        }
+
+        Op op;
+    };
+
+    // Stores the sender's address in `sender` before the byte count is
+    // reported.
+    template <typename Handler, typename Endpoint>
+    struct receive_from_op
+        : message_state
+    {
+        template <typename Buffers, typename H>
+        receive_from_op(const Buffers &buffers, Endpoint &sender, H &&h)
+            : message_state(buffers), sender(sender), handler(std::forward<H>(h))
+        {
+        }
+
+        void operator()(io_uring_cqe *cqe)
+        {
+            if (cqe->res < 0)
+            {
+                handler(std::error_code(-cqe->res, std::system_category()), 0);
+                return;
+            }
+
+            memcpy(sender.get(), &address, msg.msg_namelen);
+            sender.size() = msg.msg_namelen;
+            handler(std::error_code(), cqe->res);
+        }
+
+        Endpoint &sender;
+        typename std::decay<Handler>::type handler;
+    };
+
+    // A datagram received by datagram_socket::async_receive_multishot. The
+    // kernel lays it out in a provided buffer as an io_uring_recvmsg_out
+    // header, the sender's address, the cmsgs and the payload; the buffer
+    // goes back to its ring with the datagram.
+    class received_datagram
+    {
+    public:
+        // Room reserved in every buffer for the address and the cmsgs.
+        static constexpr socklen_t name_space = sizeof(sockaddr_in6);
+        static constexpr socklen_t control_space = CMSG_SPACE(sizeof(int));
+        static constexpr std::size_t overhead = sizeof(io_uring_recvmsg_out) + name_space + control_space;
+
+        received_datagram() noexcept = default;
+
+        explicit received_datagram(buffer_lease lease) noexcept
+            : lease_(std::move(lease))
+        {
+            if (lease_.size() < overhead)
+                return;
+
+            io_uring_recvmsg_out out;
+            memcpy(&out, lease_.data(), sizeof(out));
+            char *name = lease_.data() + sizeof(out);
+            char *control = name + name_space;
+            char *payload = control + control_space;
+
+            socklen_t name_length = std::min<socklen_t>(out.namelen, name_space);
+            memcpy(sender_.get(), name, name_length);
+            sender_.size() = name_length;
+
+            payload_ = const_buffer(payload, std::min<std::size_t>(out.payloadlen, lease_.size() - overhead));
+            truncated_ = out.flags & MSG_TRUNC;
+
+            msghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_control = control;
+            msg.msg_controllen = std::min<socklen_t>(out.controllen, control_space);
+            for (cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+            {
+                if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO)
+                {
+                    int size;
+                    memcpy(&size, CMSG_DATA(cmsg), sizeof(size));
+                    segment_size_ = size;
+                }
+            }
+        }
+
+        explicit operator bool() const noexcept
+        {
+            return static_cast<bool>(lease_);
+        }
+
+        const generic_endpoint &sender() const noexcept
+        {
+            return sender_;
+        }
+
+        const_buffer payload() const noexcept
+        {
+            return payload_;
+        }
+
+        // With GRO enabled, several datagrams of this size (the last one
+        // may be shorter) are coalesced in the payload; 0 otherwise.
+        std::size_t segment_size() const noexcept
+        {
+            return segment_size_;
+        }
+
+        // The datagram did not fit in the buffer and was cut short.
+        bool truncated() const noexcept
+        {
+            return truncated_;
+        }
+
+        void release() noexcept
+        {
+            lease_.release();
+            payload_ = const_buffer();
+        }
+
+    private:
+        buffer_lease lease_;
+        generic_endpoint sender_;
+        const_buffer payload_;
+        std::size_t segment_size_ = 0;
+        bool truncated_ = false;
+    };
+
+    class datagram_socket : public socket_base
+    {
+    public:
+        explicit datagram_socket(uring &ring)
+            : socket_base(ring) {}
+
+        template <typename Protocol>
+        void open(const Protocol &protocol)
+        {
+            int sock = ::socket(protocol.domain(), protocol.type(), protocol.protocol());
+            if (sock < 0)
+                throw std::system_error(errno, std::system_category(), __func__);
+            this->assign(sock);
+        }
+
+        template <typename Endpoint>
+        void bind(const Endpoint &endpoint)
+        {
+            if (::bind(this->native_handle(),
+                       endpoint.get(), endpoint.size()) < 0)
+                throw std::system_error(errno, std::system_category(), __func__);
+        }
+
+        // Sends one datagram to `destination` with IORING_OP_SENDMSG.
+        template <typename ConstBufferSequence, typename Endpoint, typename Handler>
+        typename std::enable_if<is_const_buffer_sequence<ConstBufferSequence>::value,
+                                async_return_t<Handler, void(std::error_code, std::size_t)>>::type
+        async_send_to(const ConstBufferSequence &buffers, const Endpoint &destination, Handler &&handler);
+
+        // Sends the payload as datagrams of `segment_size` bytes (the last
+        // one may be shorter) with a single sendmsg, through a UDP_SEGMENT
+        // cmsg.
+        template <typename ConstBufferSequence, typename Endpoint, typename Handler>
+        typename std::enable_if<is_const_buffer_sequence<ConstBufferSequence>::value,
+                                async_return_t<Handler, void(std::error_code, std::size_t)>>::type
+        async_send_to(const ConstBufferSequence &buffers, const Endpoint &destination,
+                      std::uint16_t segment_size, Handler &&handler);
+
+        // Receives one datagram with IORING_OP_RECVMSG; `sender` must stay
+        // valid until the handler runs.
+        template <typename MutableBufferSequence, typename Endpoint, typename Handler>
+        typename std::enable_if<is_mutable_buffer_sequence<MutableBufferSequence>::value,
+                                async_return_t<Handler, void(std::error_code, std::size_t)>>::type
+        async_receive_from(const MutableBufferSequence &buffers, Endpoint &sender, Handler &&handler);
+
+        // Arms a multishot recvmsg drawing buffers from `buffers`, which
+        // must be larger than received_datagram::overhead. The handler is
+        // invoked as handler(std::error_code, received_datagram) for every
+        // datagram. std::errc::no_buffer_space ends it when the ring runs
+        // dry; the handler may re-arm it once datagrams have been released.
+        template <typename Handler>
+        void async_receive_multishot(buffer_ring &buffers, Handler &&handler);
+
+    private:
+        template <typename Op, typename Prepare, typename Handler, typename... Args>
+        void submit_message(Prepare &&prepare, Handler &&handler, Args &&...args);
+    };
+
+    template <typename ConstBufferSequence, typename Endpoint, typename Handler>
+    typename std::enable_if<is_const_buffer_sequence<ConstBufferSequence>::value,
+                            async_return_t<Handler, void(std::error_code, std::size_t)>>::type
+    datagram_socket::async_send_to(const ConstBufferSequence &buffers, const Endpoint &destination, Handler &&handler)
+    {
+        return async_send_to(buffers, destination, 0, std::forward<Handler>(handler));
+    }
+
+    template <typename ConstBufferSequence, typename Endpoint, typename Handler>
+    typename std::enable_if<is_const_buffer_sequence<ConstBufferSequence>::value,
+                            async_return_t<Handler, void(std::error_code, std::size_t)>>::type
+    datagram_socket::async_send_to(const ConstBufferSequence &buffers, const Endpoint &destination,
+                                   std::uint16_t segment_size, Handler &&handler)
+    {
+        return async_initiate<void(std::error_code, std::size_t)>(
+            [this, buffers, destination, segment_size](auto &&handler)
+            {
+                using H = decltype(handler);
+                using op_type = message_op<transfer_op<H>>;
+                submit_message<op_type>(
+                    [&](io_uring_sqe *sqe, op_type &op)
+                    {
+                        op.set_name(destination.get(), destination.size());
+                        if (segment_size)
+                            op.set_segment_size(segment_size);
+                        sqe->opcode = IORING_OP_SENDMSG;
+                        sqe->addr = reinterpret_cast<__u64>(&op.msg); },
+                    std::forward<H>(handler), buffers);
+            },
+            std::forward<Handler>(handler));
+    }
+
+    template <typename MutableBufferSequence, typename Endpoint, typename Handler>
+    typename std::enable_if<is_mutable_buffer_sequence<MutableBufferSequence>::value,
+                            async_return_t<Handler, void(std::error_code, std::size_t)>>::type
+    datagram_socket::async_receive_from(const MutableBufferSequence &buffers, Endpoint &sender, Handler &&handler)
+    {
+        return async_initiate<void(std::error_code, std::size_t)>(
+            [this, buffers, &sender](auto &&handler)
+            {
+                using H = decltype(handler);
+                using op_type = receive_from_op<H, Endpoint>;
+                submit_message<op_type>(
+                    [&](io_uring_sqe *sqe, op_type &op)
+                    {
+                        op.receive_name();
+                        sqe->opcode = IORING_OP_RECVMSG;
+                        sqe->addr = reinterpret_cast<__u64>(&op.msg); },
+                    std::forward<H>(handler), buffers, sender);
+            },
+            std::forward<Handler>(handler));
+    }
+
+    template <typename Op, typename Prepare, typename Handler, typename... Args>
+    void datagram_socket::submit_message(Prepare &&prepare, Handler &&handler, Args &&...args)
+    {
+        using allocator_type = typename associated_allocator<typename std::decay<Handler>::type,
+                                                             recycling_allocator<void>>::type;
+        using op_type = wrapped_operation<Op, allocator_type>;
+
+        get_uring().submit([&](io_uring_sqe *sqe)
+                           {
+                cancellation_slot slot = get_associated_cancellation_slot(handler);
+                __u64 user_data = op_type::create(
+                    get_associated_allocator(handler, get_uring().get_allocator()),
+                    std::forward<Args>(args)..., std::forward<Handler>(handler));
+                memset(sqe, 0, sizeof(*sqe));
+                this->prepare_fd(sqe);
+                prepare(sqe, static_cast<op_type *>(reinterpret_cast<void *>(user_data))->t);
+                sqe->user_data = user_data;
+                slot.assign(get_uring(), user_data); });
+    }
+
+    template <typename Handler>
+    void datagram_socket::async_receive_multishot(buffer_ring &buffers, Handler &&handler)
+    {
+        struct receive_op
+        {
+            receive_op(datagram_socket &sock, buffer_ring &buffers, Handler &&h)
+                : sock_(sock), buffers_(buffers), handler_(std::forward<Handler>(h))
+            {
+                // Only the lengths are read: they fix the layout of every
+                // buffer the kernel fills.
+                memset(&msg_, 0, sizeof(msg_));
+                msg_.msg_namelen = received_datagram::name_space;
+                msg_.msg_controllen = received_datagram::control_space;
+            }
+
+            void prepare(io_uring_sqe *sqe)
+            {
+                memset(sqe, 0, sizeof(*sqe));
+                sqe->opcode = IORING_OP_RECVMSG;
+                sock_.prepare_fd(sqe);
+                sqe->addr = reinterpret_cast<__u64>(&msg_);
+                sqe->len = 1;
+                sqe->ioprio = IORING_RECV_MULTISHOT;
+                sqe->flags |= IOSQE_BUFFER_SELECT;
+                sqe->buf_group = buffers_.group_id();
+            }
+
+            bool operator()(io_uring_cqe *cqe)
+            {
+                buffer_lease lease;
+                if (cqe->flags & IORING_CQE_F_BUFFER)
+                    lease = buffer_lease(buffers_, static_cast<__u16>(cqe->flags >> IORING_CQE_BUFFER_SHIFT),
+                                         cqe->res > 0 ? cqe->res : 0);
+
+                if (cqe->res < 0)
+                {
+                    handler_(std::error_code(-cqe->res, std::system_category()), received_datagram());
+                    return false;
+                }
+
+                bool rearmed = false;
+                if (!(cqe->flags & IORING_CQE_F_MORE))
+                {
+                    __u64 user_data = cqe->user_data;
+                    sock_.get_uring().submit([&](io_uring_sqe *sqe)
+                                             {
+                            prepare(sqe);
+                            sqe->user_data = user_data; });
+                    rearmed = true;
+                }
+
+                handler_(std::error_code(), received_datagram(std::move(lease)));
+                return rearmed;
+            }
+
+            datagram_socket &sock_;
+            buffer_ring &buffers_;
+            msghdr msg_;
+            typename std::decay<Handler>::type handler_;
+        };
+
+        using allocator_type = typename associated_allocator<typename std::decay<Handler>::type,
+                                                             recycling_allocator<void>>::type;
+        using op_type = multishot_operation<receive_op, allocator_type>;
+
+        get_uring().submit([&](io_uring_sqe *sqe)
+                           {
+                __u64 user_data = op_type::create(
+                    get_associated_allocator(handler, get_uring().get_allocator()),
+                    *this, buffers, std::forward<Handler>(handler));
+                static_cast<op_type *>(reinterpret_cast<void *>(user_data))->t.prepare(sqe);
+                sqe->user_data = user_data; });
+    }
+}
+
+#endif /* IORING_DATAGRAM_SOCKET_HPP */
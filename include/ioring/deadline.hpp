@@ -0,0 +1,147 @@
+#ifndef IORING_DEADLINE_HPP
+#define IORING_DEADLINE_HPP
+
+#include <ioring/uring.hpp>
+#include <ioring/cancellation.hpp>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <memory>
+
+namespace ioring
+{
+
+    // Completion of an operation submitted with a linked
+    // IORING_OP_LINK_TIMEOUT. The kernel reads the timespec when the link
+    // is submitted, so it lives with the operation. Both SQEs post a CQE,
+    // in either order; Op runs once both have arrived. An operation cut
+    // short by the timeout is reported as -ETIMEDOUT, while one cancelled
+    // otherwise, such as through the handler's cancellation slot, keeps
+    // -ECANCELED.
+    template <typename Op, typename Allocator = std::allocator<void>>
+    struct deadline_operation
+        : operation
+    {
+        using allocator_type = typename std::allocator_traits<Allocator>::template rebind_alloc<deadline_operation>;
+
+        struct timeout_operation
+            : operation
+        {
+            deadline_operation *owner;
+        };
+
+        template <typename... Args>
+        explicit deadline_operation(const Allocator &alloc, std::chrono::nanoseconds timeout, Args &&...args)
+            : operation{do_complete}, alloc(alloc), res(0), flags(0), outstanding(2), timed_out(false), op(std::forward<Args>(args)...)
+        {
+            timeout_op.complete = timeout_complete;
+            timeout_op.owner = this;
+
+            if (timeout.count() < 0)
+                timeout = std::chrono::nanoseconds(0);
+            ts.tv_sec = std::chrono::duration_cast<std::chrono::seconds>(timeout).count();
+            ts.tv_nsec = (timeout % std::chrono::seconds(1)).count();
+        }
+
+        static void do_complete(io_uring_cqe *cqe)
+        {
+            auto self = static_cast<deadline_operation *>(reinterpret_cast<void *>(cqe->user_data));
+            self->res = cqe->res;
+            self->flags = cqe->flags;
+            if (--self->outstanding == 0)
+                self->finish();
+        }
+
+        // The timeout completes with -ECANCELED unless it fired; once fired
+        // it reports -ETIME, or why the operation could not be cancelled.
+        static void timeout_complete(io_uring_cqe *cqe)
+        {
+            deadline_operation *self = static_cast<timeout_operation *>(reinterpret_cast<void *>(cqe->user_data))->owner;
+            self->timed_out = cqe->res != -ECANCELED;
+            if (--self->outstanding == 0)
+                self->finish();
+        }
+
+        void finish()
+        {
+            io_uring_cqe result = {};
+            result.user_data = reinterpret_cast<__u64>(static_cast<void *>(this));
+            result.res = timed_out && (res == -ECANCELED || res == -EINTR) ? -ETIMEDOUT : res;
+            result.flags = flags;
+
+            allocator_type a(alloc);
+            Op t2 = std::move(op);
+            this->~deadline_operation();
+            a.deallocate(this, 1);
+            t2(&result);
+        }
+
+        template <typename Alloc, typename... Args>
+        static deadline_operation<Op, Alloc> *create(const Alloc &alloc, Args &&...args)
+        {
+            using op_type = deadline_operation<Op, Alloc>;
+            typename op_type::allocator_type a(alloc);
+            op_type *op = a.allocate(1);
+            try
+            {
+                ::new (static_cast<void *>(op)) op_type(alloc, std::forward<Args>(args)...);
+            }
+            catch (...)
+            {
+                a.deallocate(op, 1);
+                throw;
+            }
+#if IORING_ENABLE_TRACING
+            trace_create(reinterpret_cast<__u64>(static_cast<void *>(op)));
+#endif
+            return op;
+        }
+
+        Allocator alloc;
+        timeout_operation timeout_op;
+        __kernel_timespec ts;
+        __s32 res;
+        __u32 flags;
+        unsigned char outstanding;
+        bool timed_out;
+        Op op;
+    };
+
+    // Submits the SQE filled in by `prepare` followed by a linked timeout.
+    // The completion is an Op constructed from (args..., handler).
+    template <typename Op, typename Prepare, typename Handler, typename... Args>
+    void submit_with_deadline(uring &ring, std::chrono::nanoseconds timeout, Prepare &&prepare,
+                              Handler &&handler, Args &&...args)
+    {
+        using allocator_type = typename associated_allocator<typename std::decay<Handler>::type,
+                                                             recycling_allocator<void>>::type;
+        using op_type = deadline_operation<Op, allocator_type>;
+
+        submission_batch batch(ring);
+        ring.reserve(2);
+
+        op_type *op = nullptr;
+        ring.submit([&](io_uring_sqe *sqe)
+                    {
+                prepare(sqe);
+                sqe->flags |= IOSQE_IO_LINK;
+                cancellation_slot slot = get_associated_cancellation_slot(handler);
+                op = op_type::create(
+                    get_associated_allocator(handler, ring.get_allocator()),
+                    timeout, std::forward<Args>(args)..., std::forward<Handler>(handler));
+                sqe->user_data = reinterpret_cast<__u64>(static_cast<void *>(op));
+                slot.assign(ring, sqe->user_data); });
+
+        ring.submit([&](io_uring_sqe *sqe)
+                    {
+                memset(sqe, 0, sizeof(*sqe));
+                sqe->opcode = IORING_OP_LINK_TIMEOUT;
+                sqe->addr = reinterpret_cast<__u64>(&op->ts);
+                sqe->len = 1;
+                sqe->user_data = reinterpret_cast<__u64>(static_cast<void *>(&op->timeout_op)); });
+    }
+
+}
+
+#endif /* IORING_DEADLINE_HPP */
@@ -3,33 +3,65 @@
 
 #include <ioring/uring.hpp>
 #include <ioring/post.hpp>
+#include <ioring/deadline.hpp>
+#include <ioring/cancellation.hpp>
 
 namespace ioring
 {
 
+    // Completion for operations whose result is a byte count.
+    template <typename Handler>
+    struct transfer_op
+    {
+        template <typename H>
+        explicit transfer_op(H &&h)
+            : handler(std::forward<H>(h))
+        {
+        }
+
+        void operator()(io_uring_cqe *cqe)
+        {
+            if (cqe->res < 0)
+            {
+                handler(std::error_code(-cqe->res, std::system_category()),
+                        0);
+            }
+            else
+            {
+                handler(std::error_code(), cqe->res);
+            }
+        }
+
+        typename std::decay<Handler>::type handler;
+    };
+
     class descriptor
     {
     public:
         explicit descriptor(uring &ring)
-            : ring_(ring), fd_(-1) {}
+            : ring_(ring), fd_(-1), direct_(false) {}
 
         ~descriptor()
         {
-            if (fd_ > -1)
-            {
-                ::close(fd_);
-            }
+            reset();
         }
 
         void assign(int fd)
         {
-            if (fd_ > -1)
-            {
-                ::close(fd_);
-            }
+            reset();
             fd_ = fd;
         }
 
+        // Adopts slot `index` of the ring's registered file table. Operations
+        // on a direct descriptor are submitted with IOSQE_FIXED_FILE and
+        // native_handle() returns the slot rather than a process fd.
+        void assign_direct(int index)
+        {
+            reset();
+            fd_ = index;
+            direct_ = true;
+        }
+
         int native_handle() const noexcept
         {
             return fd_;
@@ -40,47 +72,225 @@ namespace ioring
             return fd_ > -1;
         }
 
+        bool is_direct() const noexcept
+        {
+            return direct_;
+        }
+
         uring &get_uring() const noexcept
         {
             return ring_;
         }
 
+        void prepare_fd(io_uring_sqe *sqe) const noexcept
+        {
+            sqe->fd = fd_;
+            if (direct_)
+                sqe->flags |= IOSQE_FIXED_FILE;
+        }
+
+        // Moves up to `size` bytes to `out` with IORING_OP_SPLICE, without
+        // copying them through user space. One of the two must be a pipe.
         template <typename Handler>
-        void async_close(Handler &&h)
+        async_return_t<Handler, void(std::error_code, std::size_t)>
+        async_splice(const descriptor &out, std::size_t size, Handler &&handler);
+
+        // Duplicates up to `size` bytes from this pipe into the pipe `out`
+        // with IORING_OP_TEE; they stay readable from this one.
+        template <typename Handler>
+        async_return_t<Handler, void(std::error_code, std::size_t)>
+        async_tee(const descriptor &out, std::size_t size, Handler &&handler);
+
+        // Cancels every operation in flight on the descriptor, including
+        // multishot ones; they complete with std::errc::operation_canceled.
+        void cancel()
         {
-            struct close_op
-            {
-                close_op(descriptor &desc, Handler &&h)
-                    : desc_(desc),
-                      handler_(std::forward<Handler>(h))
-                {
-                }
+            ring_.submit_detached(detached_op::cancel, fd_, [&](io_uring_sqe *sqe)
+                                  { prepare_cancel(sqe); });
+        }
 
-                void operator()(io_uring_cqe *cqe)
+        // Cancels operations still in flight on the descriptor, then closes
+        // it. The two SQEs are hard-linked so the close runs even when there
+        // was nothing to cancel.
+        template <typename Handler>
+        async_return_t<Handler, void(std::error_code)>
+        async_close(Handler &&h)
+        {
+            return async_initiate<void(std::error_code)>(
+                [this](auto &&h)
                 {
-                    desc_.fd_ = -1;
+                    using H = decltype(h);
+                    struct close_op
+                    {
+                        close_op(descriptor &desc, H &&h)
+                            : desc_(desc),
+                              handler_(std::forward<H>(h))
+                        {
+                        }
 
-                    std::error_code ec = {-cqe->res, std::system_category()};
-                    handler_(ec);
-                }
+                        void operator()(io_uring_cqe *cqe)
+                        {
+                            desc_.fd_ = -1;
+                            desc_.direct_ = false;
+
+                            std::error_code ec = {-cqe->res, std::system_category()};
+                            handler_(ec);
+                        }
+
+                        descriptor &desc_;
+                        typename std::decay<H>::type handler_;
+                    };
+
+                    submission_batch batch(ring_);
+                    ring_.reserve(2);
+
+                    ring_.submit_detached(detached_op::cancel, fd_, [&](io_uring_sqe *sqe)
+                                          {
+                            prepare_cancel(sqe);
+                            sqe->flags |= IOSQE_IO_HARDLINK; });
+
+                    ring_.submit([&](io_uring_sqe *sqe)
+                                 {
+                            memset(sqe, 0, sizeof(*sqe));
+                            sqe->opcode = IORING_OP_CLOSE;
+                            if (direct_)
+                                sqe->file_index = fd_ + 1;
+                            else
+                                sqe->fd = fd_;
+                            sqe->user_data = wrapped_operation<close_op>::create(
+                                get_associated_allocator(h, ring_.get_allocator()), *this, std::forward<H>(h)); });
+                },
+                std::forward<Handler>(h));
+        }
+
+        // Like async_close, without a completion: the descriptor is released
+        // at once and nothing is allocated. A failure reaches the ring's
+        // error sink.
+        void async_close(detached_t)
+        {
+            if (fd_ < 0)
+                return;
+
+            submission_batch batch(ring_);
+            ring_.reserve(2);
 
-                descriptor &desc_;
-                typename std::decay<Handler>::type handler_;
-            };
+            ring_.submit_detached(detached_op::cancel, fd_, [&](io_uring_sqe *sqe)
+                                  {
+                    prepare_cancel(sqe);
+                    sqe->flags |= IOSQE_IO_HARDLINK; });
 
-            ring_.submit([&](io_uring_sqe *sqe)
-                         {
+            ring_.submit_detached(detached_op::close, fd_, [&](io_uring_sqe *sqe)
+                                  {
                     memset(sqe, 0, sizeof(*sqe));
                     sqe->opcode = IORING_OP_CLOSE;
-                    sqe->fd = fd_;
-                    sqe->user_data = wrapped_operation<close_op>::create(*this, std::forward<Handler>(h)); });
+                    if (direct_)
+                        sqe->file_index = fd_ + 1;
+                    else
+                        sqe->fd = fd_; });
+
+            fd_ = -1;
+            direct_ = false;
         }
 
     private:
+        void prepare_cancel(io_uring_sqe *sqe) const noexcept
+        {
+            memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->fd = fd_;
+            sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+            if (direct_)
+                sqe->cancel_flags |= IORING_ASYNC_CANCEL_FD_FIXED;
+        }
+
+        void reset() noexcept
+        {
+            if (fd_ < 0)
+                return;
+
+            if (direct_)
+            {
+                int none = -1;
+                try
+                {
+                    ring_.update_files(fd_, &none, 1);
+                }
+                catch (...)
+                {
+                }
+            }
+            else
+            {
+                ::close(fd_);
+            }
+            fd_ = -1;
+            direct_ = false;
+        }
+
         uring &ring_;
         int fd_;
+        bool direct_;
     };
 
+    // Fills in an IORING_OP_SPLICE or IORING_OP_TEE moving `size` bytes from
+    // `in` to `out`, at the current file positions for a splice.
+    inline void prepare_splice(io_uring_sqe *sqe, __u8 opcode, const descriptor &in,
+                               const descriptor &out, std::size_t size) noexcept
+    {
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = opcode;
+        out.prepare_fd(sqe);
+        sqe->splice_fd_in = in.native_handle();
+        if (in.is_direct())
+            sqe->splice_flags |= SPLICE_F_FD_IN_FIXED;
+        if (opcode == IORING_OP_SPLICE)
+        {
+            sqe->splice_off_in = static_cast<__u64>(-1);
+            sqe->off = static_cast<__u64>(-1);
+        }
+        sqe->len = size;
+    }
+
+    template <typename Handler>
+    async_return_t<Handler, void(std::error_code, std::size_t)>
+    descriptor::async_splice(const descriptor &out, std::size_t size, Handler &&handler)
+    {
+        return async_initiate<void(std::error_code, std::size_t)>(
+            [this, &out, size](auto &&handler)
+            {
+                using H = decltype(handler);
+                ring_.submit([&](io_uring_sqe *sqe)
+                             {
+                        prepare_splice(sqe, IORING_OP_SPLICE, *this, out, size);
+                        cancellation_slot slot = get_associated_cancellation_slot(handler);
+                        sqe->user_data = wrapped_operation<transfer_op<H>>::create(
+                            get_associated_allocator(handler, ring_.get_allocator()),
+                            std::forward<H>(handler));
+                        slot.assign(ring_, sqe->user_data); });
+            },
+            std::forward<Handler>(handler));
+    }
+
+    template <typename Handler>
+    async_return_t<Handler, void(std::error_code, std::size_t)>
+    descriptor::async_tee(const descriptor &out, std::size_t size, Handler &&handler)
+    {
+        return async_initiate<void(std::error_code, std::size_t)>(
+            [this, &out, size](auto &&handler)
+            {
+                using H = decltype(handler);
+                ring_.submit([&](io_uring_sqe *sqe)
+                             {
+                        prepare_splice(sqe, IORING_OP_TEE, *this, out, size);
+                        cancellation_slot slot = get_associated_cancellation_slot(handler);
+                        sqe->user_data = wrapped_operation<transfer_op<H>>::create(
+                            get_associated_allocator(handler, ring_.get_allocator()),
+                            std::forward<H>(handler));
+                        slot.assign(ring_, sqe->user_data); });
+            },
+            std::forward<Handler>(handler));
+    }
+
 }
 
 #endif /* IORING_DESCRIPTOR_HPP */
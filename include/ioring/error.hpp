@@ -0,0 +1,56 @@
+#ifndef IORING_ERROR_HPP
+#define IORING_ERROR_HPP
+
+#include <string>
+#include <system_error>
+
+namespace ioring
+{
+
+    // Errors that do not come from the kernel.
+    enum class misc_errc
+    {
+        // The peer closed the stream before the requested data arrived.
+        eof = 1,
+    };
+
+    inline const std::error_category &misc_category() noexcept
+    {
+        struct category : std::error_category
+        {
+            const char *name() const noexcept override
+            {
+                return "ioring.misc";
+            }
+
+            std::string message(int ev) const override
+            {
+                switch (static_cast<misc_errc>(ev))
+                {
+                case misc_errc::eof:
+                    return "End of file";
+                }
+                return "Unknown error";
+            }
+        };
+
+        static const category instance;
+        return instance;
+    }
+
+    inline std::error_code make_error_code(misc_errc e) noexcept
+    {
+        return std::error_code(static_cast<int>(e), misc_category());
+    }
+
+}
+
+namespace std
+{
+    template <>
+    struct is_error_code_enum<ioring::misc_errc> : true_type
+    {
+    };
+}
+
+#endif /* IORING_ERROR_HPP */
@@ -0,0 +1,73 @@
+#ifndef IORING_IMPL_BUFFER_RING_IPP
+#define IORING_IMPL_BUFFER_RING_IPP
+
+#include <ioring/buffer_ring.hpp>
+
+#include <cerrno>
+#include <cstddef>
+#include <system_error>
+
+#include <sys/mman.h>
+
+namespace ioring
+{
+
+    buffer_ring::buffer_ring(uring &ring, __u16 group_id, unsigned entries, std::size_t buffer_size)
+        : ring_(ring),
+          group_id_(group_id),
+          entries_(entries),
+          buffer_size_(buffer_size),
+          ring_ptr_(MAP_FAILED),
+          bufs_(nullptr),
+          tail_ptr_(nullptr),
+          tail_(0)
+    {
+        if (entries == 0 || entries > 32768 || (entries & (entries - 1)) != 0)
+            throw std::system_error(std::make_error_code(std::errc::invalid_argument), __func__);
+
+        void *ptr = ::mmap(0, entries * sizeof(io_uring_buf), PROT_READ | PROT_WRITE,
+                           MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+        if (ptr == MAP_FAILED)
+            throw std::system_error(errno, std::system_category(), __func__);
+
+        // The ring tail overlays the reserved field of the first entry. The
+        // bufs flexible array member is not used because C++ compilers lay
+        // it out past an empty placeholder struct.
+        ring_ptr_ = ptr;
+        bufs_ = ioring::object_at<io_uring_buf[]>(ptr, 0);
+        tail_ptr_ = ioring::object_at<std::atomic<__u16>>(ptr, offsetof(io_uring_buf, resv));
+
+        io_uring_buf_reg reg = {};
+        reg.ring_addr = reinterpret_cast<__u64>(ptr);
+        reg.ring_entries = entries;
+        reg.bgid = group_id;
+        try
+        {
+            storage_.reset(new char[entries * buffer_size]);
+            ring_.register_buffer_ring(reg);
+        }
+        catch (...)
+        {
+            ::munmap(ptr, entries * sizeof(io_uring_buf));
+            throw;
+        }
+
+        for (unsigned i = 0; i < entries; ++i)
+            recycle(static_cast<__u16>(i));
+    }
+
+    buffer_ring::~buffer_ring()
+    {
+        try
+        {
+            ring_.unregister_buffer_ring(group_id_);
+        }
+        catch (...)
+        {
+        }
+        ::munmap(ring_ptr_, entries_ * sizeof(io_uring_buf));
+    }
+
+}
+
+#endif /* IORING_IMPL_BUFFER_RING_IPP */
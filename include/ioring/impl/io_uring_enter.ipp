@@ -16,6 +16,14 @@ namespace ioring
                             flags, (void *)0, 0);
     }
 
+    int io_uring_enter(int ring_fd, unsigned int to_submit,
+                       unsigned int min_complete, unsigned int flags,
+                       const void *arg, std::size_t argsz)
+    {
+        return (int)syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete,
+                            flags, arg, argsz);
+    }
+
 }
 
 #endif /* IORING_IMPL_IO_URING_ENTER_IPP */
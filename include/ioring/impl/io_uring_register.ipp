@@ -0,0 +1,20 @@
+#ifndef IORING_IMPL_IO_URING_REGISTER_IPP
+#define IORING_IMPL_IO_URING_REGISTER_IPP
+
+#include <ioring/io_uring_register.hpp>
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace ioring
+{
+
+    int io_uring_register(int ring_fd, unsigned int opcode,
+                          const void *arg, unsigned int nr_args)
+    {
+        return (int)syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args);
+    }
+
+}
+
+#endif /* IORING_IMPL_IO_URING_REGISTER_IPP */
@@ -0,0 +1,24 @@
+#ifndef IORING_IMPL_OPERATION_POOL_IPP
+#define IORING_IMPL_OPERATION_POOL_IPP
+
+#include <ioring/operation_pool.hpp>
+
+namespace ioring
+{
+
+    operation_pool::~operation_pool()
+    {
+        for (block *&head : free_)
+        {
+            while (head)
+            {
+                block *next = head->next;
+                ::operator delete(head);
+                head = next;
+            }
+        }
+    }
+
+}
+
+#endif /* IORING_IMPL_OPERATION_POOL_IPP */
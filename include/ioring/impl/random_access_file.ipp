@@ -0,0 +1,77 @@
+#ifndef IORING_IMPL_RANDOM_ACCESS_FILE_IPP
+#define IORING_IMPL_RANDOM_ACCESS_FILE_IPP
+
+#include <ioring/random_access_file.hpp>
+
+#include <cerrno>
+#include <cstdint>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+namespace ioring
+{
+
+    void random_access_file::open(const char *path, int flags, mode_t mode)
+    {
+        int fd = ::open(path, flags | O_CLOEXEC, mode);
+        if (fd < 0)
+            throw std::system_error(errno, std::system_category(), __func__);
+        descriptor::assign(fd);
+        opened(flags);
+    }
+
+    void random_access_file::assign(int fd)
+    {
+        descriptor::assign(fd);
+        int flags = ::fcntl(fd, F_GETFL);
+        if (flags < 0)
+            throw std::system_error(errno, std::system_category(), __func__);
+        opened(flags);
+    }
+
+    void random_access_file::opened(int flags)
+    {
+        direct_io_ = (flags & O_DIRECT) != 0;
+        memory_alignment_ = 1;
+        offset_alignment_ = 1;
+        if (!direct_io_)
+            return;
+
+        // Prefer what the file system reports for direct I/O; the logical
+        // block size is a safe guess otherwise.
+        struct statx stx = {};
+#ifdef STATX_DIOALIGN
+        unsigned mask = STATX_DIOALIGN | STATX_BASIC_STATS;
+#else
+        unsigned mask = STATX_BASIC_STATS;
+#endif
+        if (::statx(native_handle(), "", AT_EMPTY_PATH, mask, &stx) < 0)
+            throw std::system_error(errno, std::system_category(), __func__);
+
+#ifdef STATX_DIOALIGN
+        if ((stx.stx_mask & STATX_DIOALIGN) && stx.stx_dio_mem_align != 0)
+        {
+            memory_alignment_ = stx.stx_dio_mem_align;
+            offset_alignment_ = stx.stx_dio_offset_align;
+            return;
+        }
+#endif
+        memory_alignment_ = stx.stx_blksize;
+        offset_alignment_ = stx.stx_blksize;
+    }
+
+    void random_access_file::check_alignment(const void *data, std::size_t size, std::uint64_t offset) const
+    {
+        if (!direct_io_)
+            return;
+
+        if (reinterpret_cast<std::uintptr_t>(data) % memory_alignment_ != 0 ||
+            size % offset_alignment_ != 0 || offset % offset_alignment_ != 0)
+            throw std::system_error(std::make_error_code(std::errc::invalid_argument), "random_access_file: misaligned O_DIRECT transfer");
+    }
+
+}
+
+#endif /* IORING_IMPL_RANDOM_ACCESS_FILE_IPP */
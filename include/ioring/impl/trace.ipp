@@ -0,0 +1,106 @@
+#ifndef IORING_IMPL_TRACE_IPP
+#define IORING_IMPL_TRACE_IPP
+
+#include <ioring/trace.hpp>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+
+namespace ioring
+{
+
+    trace_buffer::trace_buffer(std::size_t capacity)
+        : mask_(0), head_(0)
+    {
+        std::size_t size = 1;
+        while (size < capacity)
+            size <<= 1;
+        events_.reset(new trace_event[size]);
+        mask_ = size - 1;
+    }
+
+    std::vector<trace_event> trace_buffer::snapshot() const
+    {
+        std::uint64_t size = mask_ + 1;
+        std::uint64_t end = head_.load(std::memory_order_acquire);
+        std::uint64_t begin = end > size ? end - size : 0;
+
+        std::vector<trace_event> events;
+        events.reserve(end - begin);
+        for (std::uint64_t i = begin; i != end; ++i)
+            events.push_back(events_[i & mask_]);
+
+        // The slot of index `head` may be half written by now, and every
+        // event it and later records replaced is lost.
+        std::uint64_t head = head_.load(std::memory_order_acquire);
+        std::uint64_t valid = head + 1 > size ? head + 1 - size : 0;
+        if (valid > begin)
+            events.erase(events.begin(), events.begin() + static_cast<std::ptrdiff_t>(std::min(valid, end) - begin));
+        return events;
+    }
+
+    void trace_buffer::write_chrome_trace(std::ostream &os, int tid) const
+    {
+        std::vector<trace_event> events = snapshot();
+        char line[384];
+
+        os << "{\"traceEvents\":[";
+        const char *sep = "\n";
+        for (const trace_event &e : events)
+        {
+            double ts = static_cast<double>(e.timestamp_ns) / 1000.0;
+            const char *name = opcode_name(e.opcode);
+            int n = 0;
+            switch (e.kind)
+            {
+            case trace_event::create:
+                n = std::snprintf(line, sizeof(line),
+                                  "{\"name\":\"create\",\"cat\":\"ioring\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,"
+                                  "\"args\":{\"op\":\"0x%" PRIx64 "\",\"parent\":\"0x%" PRIx64 "\"}}",
+                                  ts, tid, e.op, e.parent);
+                break;
+            case trace_event::submit:
+                n = std::snprintf(line, sizeof(line),
+                                  "{\"name\":\"%s\",\"cat\":\"ioring\",\"ph\":\"b\",\"id\":\"0x%" PRIx64 "\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,"
+                                  "\"args\":{\"parent\":\"0x%" PRIx64 "\",\"fd\":%d}}",
+                                  name, e.op, ts, tid, e.parent, e.fd);
+                break;
+            case trace_event::complete:
+                n = std::snprintf(line, sizeof(line),
+                                  "{\"name\":\"%s\",\"cat\":\"ioring\",\"ph\":\"e\",\"id\":\"0x%" PRIx64 "\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,"
+                                  "\"args\":{\"res\":%d,\"flags\":%u}},\n"
+                                  "{\"name\":\"%s handler\",\"cat\":\"ioring\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d,"
+                                  "\"args\":{\"op\":\"0x%" PRIx64 "\"}}",
+                                  name, e.op, ts, tid, e.res, e.flags,
+                                  name, ts, static_cast<double>(e.duration_ns) / 1000.0, tid, e.op);
+                break;
+            }
+            if (n <= 0)
+                continue;
+            os << sep;
+            os.write(line, std::min<std::streamsize>(n, sizeof(line) - 1));
+            sep = ",\n";
+        }
+        os << "\n]}\n";
+    }
+
+    const char *opcode_name(unsigned opcode) noexcept
+    {
+        static const char *const names[] = {
+            "NOP", "READV", "WRITEV", "FSYNC", "READ_FIXED", "WRITE_FIXED", "POLL_ADD",
+            "POLL_REMOVE", "SYNC_FILE_RANGE", "SENDMSG", "RECVMSG", "TIMEOUT", "TIMEOUT_REMOVE",
+            "ACCEPT", "ASYNC_CANCEL", "LINK_TIMEOUT", "CONNECT", "FALLOCATE", "OPENAT", "CLOSE",
+            "FILES_UPDATE", "STATX", "READ", "WRITE", "FADVISE", "MADVISE", "SEND", "RECV",
+            "OPENAT2", "EPOLL_CTL", "SPLICE", "PROVIDE_BUFFERS", "REMOVE_BUFFERS", "TEE",
+            "SHUTDOWN", "RENAMEAT", "UNLINKAT", "MKDIRAT", "SYMLINKAT", "LINKAT", "MSG_RING",
+            "FSETXATTR", "SETXATTR", "FGETXATTR", "GETXATTR", "SOCKET", "URING_CMD", "SEND_ZC",
+            "SENDMSG_ZC"};
+        if (opcode < sizeof(names) / sizeof(names[0]))
+            return names[opcode];
+        return "OP";
+    }
+
+}
+
+#endif /* IORING_IMPL_TRACE_IPP */
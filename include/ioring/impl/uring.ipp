@@ -4,11 +4,16 @@
 #include <ioring/uring.hpp>
 #include <ioring/io_uring_setup.hpp>
 #include <ioring/io_uring_enter.hpp>
+#include <ioring/io_uring_register.hpp>
 
 #include <system_error>
 #include <new>
+#include <cerrno>
+
+#include <cstring>
 
 #include <unistd.h>
+#include <sys/eventfd.h>
 #include <sys/mman.h>
 
 namespace ioring
@@ -20,24 +25,70 @@ namespace ioring
         return std::launder(reinterpret_cast<typename std::remove_extent<T>::type *>(reinterpret_cast<char *>(base) + offset));
     }
 
-    uring::uring(int queue_depth)
+    uring::uring(int queue_depth, const options &opts)
         : fd_(-1),
+          flags_(opts.flags),
+          features_(0),
+          wait_(opts.wait),
           sq_len_(0),
           sq_ptr_(MAP_FAILED),
           sqes_len_(0),
           sqes_ptr_(MAP_FAILED),
           cq_len_(0),
           cq_ptr_(MAP_FAILED),
-          pending_(0)
+          pending_(0),
+          sq_tail_(0),
+          sq_flushed_(0),
+          sq_entered_(0),
+          batch_depth_(0),
+          posted_(nullptr),
+          posted_count_(0),
+          posted_ready_(nullptr),
+          local_head_(nullptr),
+          local_tail_(nullptr),
+          local_since_enter_(0),
+          wake_requested_(false),
+          wake_fd_(-1),
+          wake_armed_(false),
+          wake_value_(0),
+          timeout_ts_(),
+          timeout_tick_(0),
+          timeout_armed_(false),
+          cq_overflow_flushes_(0),
+          error_sink_(nullptr),
+          error_sink_context_(nullptr)
     {
+        wake_op_.complete = wake_complete;
+        wake_op_.ring = this;
+        timeout_op_.complete = timeout_complete;
+        timeout_op_.ring = this;
+
         io_uring_params params = {};
-        params.flags = IORING_SETUP_SQPOLL;
+        params.flags = opts.flags;
+        if (opts.flags & IORING_SETUP_SQPOLL)
+        {
+            params.sq_thread_idle = opts.sq_thread_idle;
+            if (opts.sq_thread_cpu >= 0)
+            {
+                params.flags |= IORING_SETUP_SQ_AFF;
+                params.sq_thread_cpu = static_cast<__u32>(opts.sq_thread_cpu);
+            }
+        }
+        if (opts.cq_entries)
+        {
+            params.flags |= IORING_SETUP_CQSIZE;
+            params.cq_entries = opts.cq_entries;
+        }
 
         // setup io_uring file descriptor
         fd_ = io_uring_setup(queue_depth, &params);
         if (fd_ < 0)
             goto err_out;
 
+        wake_fd_ = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (wake_fd_ < 0)
+            goto err_out;
+
         // map shared memory
 
         sq_len_ = params.sq_off.array + params.sq_entries * sizeof(__u32);
@@ -85,12 +136,16 @@ namespace ioring
         cqring_.ring_entries =
             ioring::object_at<__u32>(cq_ptr_, params.cq_off.ring_entries);
         cqring_.overflow =
-            ioring::object_at<__u32>(cq_ptr_, params.cq_off.overflow);
+            ioring::object_at<std::atomic<__u32>>(cq_ptr_, params.cq_off.overflow);
         cqring_.cqes =
             ioring::object_at<io_uring_cqe[]>(cq_ptr_, params.cq_off.cqes);
         cqring_.flags =
             ioring::object_at<std::atomic<__u32>>(cq_ptr_, params.cq_off.flags);
 
+        flags_ = params.flags;
+        features_ = params.features;
+        sq_tail_ = sq_flushed_ = sq_entered_ = sqring_.tail->load(std::memory_order_relaxed);
+
         return;
 
     err_out:
@@ -101,6 +156,8 @@ namespace ioring
             ::munmap(sqes_ptr_, sqes_len_);
         if (sq_ptr_ != MAP_FAILED)
             ::munmap(sq_ptr_, sq_len_);
+        if (wake_fd_ > -1)
+            ::close(wake_fd_);
         if (fd_ > -1)
             ::close(fd_);
         throw std::system_error(ec, __func__);
@@ -108,6 +165,22 @@ namespace ioring
 
     uring::~uring()
     {
+        // Detached SQEs queued after the last run() must reach the kernel
+        // before the ring is torn down, or they are cancelled unrun. Failing
+        // that, there is nobody left to tell.
+        try
+        {
+            enter_flushed();
+            if ((flags_ & IORING_SETUP_SQPOLL) && !(flags_ & IORING_SETUP_R_DISABLED))
+            {
+                while (sqring_.head->load(std::memory_order_acquire) != sq_flushed_)
+                    wait();
+            }
+        }
+        catch (...)
+        {
+        }
+
         if (cq_ptr_ != MAP_FAILED)
             ::munmap(cq_ptr_, cq_len_);
         if (sqes_ptr_ != MAP_FAILED)
@@ -116,58 +189,741 @@ namespace ioring
             ::munmap(sq_ptr_, sq_len_);
         if (fd_ > -1)
             ::close(fd_);
+        if (wake_fd_ > -1)
+            ::close(wake_fd_);
     }
 
-    unsigned uring::complete()
+    unsigned uring::reap(unsigned limit)
     {
-        unsigned n = 0;
+        unsigned n = run_posted(limit);
+        if (n < limit)
+            n += run_local(limit - n);
         __u32 head = cqring_.head->load(std::memory_order_relaxed);
-        if (head == cqring_.tail->load(std::memory_order_acquire))
-            wait_complete();
+        __u32 tail = cqring_.tail->load(std::memory_order_acquire);
+        if (head == tail)
+        {
+            if (!cq_overflowed())
+            {
+                // While queued handlers keep run() from waiting, nothing else
+                // hands their SQEs to the kernel or runs deferred task work.
+                if (n > 0 && !(flags_ & IORING_SETUP_SQPOLL))
+                {
+                    bool task_work = (flags_ & IORING_SETUP_DEFER_TASKRUN) && local_since_enter_ >= local_run_chunk;
+                    if (task_work || sq_entered_ != sq_flushed_)
+                    {
+                        local_since_enter_ = 0;
+                        enter(0, (flags_ & IORING_SETUP_DEFER_TASKRUN) ? IORING_ENTER_GETEVENTS : 0);
+                    }
+                }
+                return n;
+            }
+            flush_overflow();
+            tail = cqring_.tail->load(std::memory_order_acquire);
+        }
+        else if (!(flags_ & IORING_SETUP_SQPOLL) && sq_entered_ != sq_flushed_)
+            enter(0, 0);
 
-        while (head != cqring_.tail->load(std::memory_order_acquire))
+        submission_batch batch(*this);
+        const __u32 mask = *cqring_.ring_mask;
+        unsigned finished = 0;
+        while (head != tail && n < limit)
         {
-            ++n;
-            __u32 index = head & *cqring_.ring_mask;
-            io_uring_cqe *cqe = &cqring_.cqes[index];
+            // One tail load per snapshot. The head is published every
+            // cq_release_chunk entries so the kernel can post into the
+            // slots already consumed while the rest are completed.
+            __u32 published = head;
+#if IORING_ENABLE_STATS
+            std::uint64_t now_ns = static_cast<std::uint64_t>(
+                std::chrono::steady_clock::now().time_since_epoch() / std::chrono::nanoseconds(1));
+            __u32 snapshot = head;
+#endif
+            for (; head != tail && n < limit; ++head)
             {
-                operation *oper = static_cast<operation *>(
-                    reinterpret_cast<void *>(cqe->user_data));
+                io_uring_cqe *cqe = &cqring_.cqes[head & mask];
+                if (head + 1 != tail)
+                    __builtin_prefetch(reinterpret_cast<void *>(cqring_.cqes[(head + 1) & mask].user_data));
+
+                // An exception from a handler propagates out of run(); the
+                // CQE it came from has been consumed either way.
+                try
+                {
+                    if (cqe->user_data & detached_tag)
+                        complete_detached(cqe);
+                    else
+                    {
+                        if (!(cqe->flags & IORING_CQE_F_MORE))
+                            ++finished;
 
-                oper->complete(cqe);
+                        operation *oper = static_cast<operation *>(
+                            reinterpret_cast<void *>(cqe->user_data));
+                        // The ring's own completions run no handler and do
+                        // not count towards `limit`.
+                        if (oper != &wake_op_ && oper != &timeout_op_ && oper != null_operation())
+                            ++n;
+#if IORING_ENABLE_STATS
+                        record_complete(oper, cqe, now_ns);
+#endif
+#if IORING_ENABLE_TRACING
+                        trace_completion(oper, cqe);
+#else
+                        oper->complete(cqe);
+#endif
+                    }
+                }
+                catch (...)
+                {
+                    cqring_.head->store(head + 1, std::memory_order_release);
+                    pending_ -= finished;
+                    throw;
+                }
+
+                if (head + 1 - published >= cq_release_chunk)
+                {
+                    published = head + 1;
+                    cqring_.head->store(published, std::memory_order_release);
+                }
             }
-            ++head;
+            cqring_.head->store(head, std::memory_order_release);
+#if IORING_ENABLE_STATS
+            stats_.cq_batch.record(head - snapshot);
+#endif
+
+            if (cq_overflowed())
+                flush_overflow();
+            tail = cqring_.tail->load(std::memory_order_acquire);
         }
-        cqring_.head->store(head, std::memory_order_release);
 
-        pending_ -= n;
+        pending_ -= finished;
         return n;
     }
 
-    void uring::wakeup()
+    // Detached SQEs only post a CQE when they fail, unless the kernel lacks
+    // IORING_FEAT_CQE_SKIP or the kind never skips; successes are ignored.
+    // Failures a kind expects are dropped, the rest go to the error sink.
+    void uring::complete_detached(const io_uring_cqe *cqe)
+    {
+        static bool (*const expected[])(int res) = {
+            [](int) { return true; },
+            [](int) { return false; },
+            [](int) { return false; },
+            [](int res) { return res == -ENOENT || res == -EALREADY; },
+        };
+
+        if (cqe->res >= 0 || !error_sink_)
+            return;
+
+        unsigned op = static_cast<unsigned>(cqe->user_data >> 1) & 0x7f;
+        if (op < sizeof(expected) / sizeof(expected[0]) && expected[op](cqe->res))
+            return;
+
+        detached_failure failure = {static_cast<detached_op>(op),
+                                    static_cast<int>(static_cast<std::uint32_t>(cqe->user_data >> 32)),
+                                    std::error_code(-cqe->res, std::system_category())};
+        error_sink_(error_sink_context_, failure);
+    }
+
+    bool uring::cq_overflowed() const noexcept
+    {
+        return sqring_.flags->load(std::memory_order_relaxed) & IORING_SQ_CQ_OVERFLOW;
+    }
+
+    void uring::flush_overflow()
+    {
+        ++cq_overflow_flushes_;
+        enter(0, IORING_ENTER_GETEVENTS);
+    }
+
+#if IORING_ENABLE_STATS
+    void uring::record_submit(const io_uring_sqe *sqe) noexcept
+    {
+        if (sqe->opcode < ring_stats::opcode_count)
+            ++stats_.submitted[sqe->opcode];
+    }
+
+    // Stamps the operations behind the SQEs about to be published with one
+    // clock read. null_operation() is shared between rings and skipped, and
+    // detached SQEs have no operation.
+    void uring::record_publish() noexcept
+    {
+        std::uint64_t now_ns = static_cast<std::uint64_t>(
+            std::chrono::steady_clock::now().time_since_epoch() / std::chrono::nanoseconds(1));
+        for (__u32 i = sq_flushed_; i != sq_tail_; ++i)
+        {
+            const io_uring_sqe *sqe = &sqring_.sqes[i & *sqring_.ring_mask];
+            operation *op = static_cast<operation *>(reinterpret_cast<void *>(sqe->user_data));
+            if ((sqe->user_data & detached_tag) || op == null_operation())
+                continue;
+            op->published_ns = now_ns;
+            op->opcode = sqe->opcode;
+        }
+    }
+
+    // Only the first CQE of a request carries its latency; CQEs of
+    // null_operation() are counted as IORING_OP_NOP.
+    void uring::record_complete(operation *op, const io_uring_cqe *cqe, std::uint64_t now_ns) noexcept
+    {
+        unsigned opcode = op->opcode < ring_stats::opcode_count ? op->opcode : static_cast<unsigned>(IORING_OP_NOP);
+        ++stats_.completed[opcode];
+        if (cqe->res < 0)
+        {
+            ++stats_.failed[opcode];
+            unsigned err = static_cast<unsigned>(-cqe->res);
+            ++stats_.errors[err < ring_stats::errno_count ? err : ring_stats::errno_count - 1];
+        }
+
+        if (op->published_ns != 0 && op != null_operation())
+        {
+            stats_.latency[opcode].record(now_ns > op->published_ns ? now_ns - op->published_ns : 0);
+            op->published_ns = 0;
+        }
+    }
+#endif
+
+#if IORING_ENABLE_TRACING
+    void trace_create(__u64 op) noexcept
+    {
+        if (uring *ring = uring::current_ring())
+            ring->trace().record({trace_buffer::now_ns(), 0, op, trace_parent(), -1, 0, 0, 0, trace_event::create});
+    }
+
+    void uring::trace_submit(const io_uring_sqe *sqe) noexcept
+    {
+        operation *op = static_cast<operation *>(reinterpret_cast<void *>(sqe->user_data));
+        if (!(sqe->user_data & detached_tag) && op != null_operation())
+            op->opcode = sqe->opcode;
+        trace_.record({trace_buffer::now_ns(), 0, sqe->user_data, trace_parent(), sqe->fd, 0, 0, sqe->opcode, trace_event::submit});
+    }
+
+    // Runs the completion with `op` as the parent of what it creates and
+    // records how long it took.
+    void uring::trace_completion(operation *op, io_uring_cqe *cqe)
+    {
+        struct restore_parent
+        {
+            std::uint64_t parent;
+            ~restore_parent() { trace_parent() = parent; }
+        } restore{trace_parent()};
+
+        trace_event e = {trace_buffer::now_ns(), 0, cqe->user_data, restore.parent, -1, cqe->res, cqe->flags,
+                         op == null_operation() ? static_cast<__u8>(IORING_OP_NOP) : op->opcode, trace_event::complete};
+        trace_parent() = cqe->user_data;
+        op->complete(cqe);
+        e.duration_ns = trace_buffer::now_ns() - e.timestamp_ns;
+        trace_.record(e);
+    }
+#endif
+
+    void uring::register_buffers(const iovec *iovecs, unsigned count)
+    {
+        do_register(IORING_REGISTER_BUFFERS, iovecs, count, __func__);
+    }
+
+    void uring::register_buffers_sparse(unsigned count)
+    {
+        io_uring_rsrc_register reg = {};
+        reg.nr = count;
+        reg.flags = IORING_RSRC_REGISTER_SPARSE;
+        do_register(IORING_REGISTER_BUFFERS2, &reg, sizeof(reg), __func__);
+    }
+
+    void uring::update_buffers(unsigned offset, const iovec *iovecs, unsigned count)
+    {
+        io_uring_rsrc_update2 update = {};
+        update.offset = offset;
+        update.data = reinterpret_cast<__u64>(iovecs);
+        update.nr = count;
+        do_register(IORING_REGISTER_BUFFERS_UPDATE, &update, sizeof(update), __func__);
+    }
+
+    void uring::unregister_buffers()
+    {
+        do_register(IORING_UNREGISTER_BUFFERS, nullptr, 0, __func__);
+    }
+
+    void uring::register_buffer_ring(const io_uring_buf_reg &reg)
+    {
+        do_register(IORING_REGISTER_PBUF_RING, &reg, 1, __func__);
+    }
+
+    void uring::unregister_buffer_ring(__u16 group_id)
+    {
+        io_uring_buf_reg reg = {};
+        reg.bgid = group_id;
+        do_register(IORING_UNREGISTER_PBUF_RING, &reg, 1, __func__);
+    }
+
+    void uring::register_files(const int *fds, unsigned count)
+    {
+        do_register(IORING_REGISTER_FILES, fds, count, __func__);
+    }
+
+    void uring::register_files_sparse(unsigned count)
+    {
+        io_uring_rsrc_register reg = {};
+        reg.nr = count;
+        reg.flags = IORING_RSRC_REGISTER_SPARSE;
+        do_register(IORING_REGISTER_FILES2, &reg, sizeof(reg), __func__);
+    }
+
+    void uring::update_files(unsigned offset, const int *fds, unsigned count)
+    {
+        io_uring_rsrc_update2 update = {};
+        update.offset = offset;
+        update.data = reinterpret_cast<__u64>(fds);
+        update.nr = count;
+        do_register(IORING_REGISTER_FILES_UPDATE2, &update, sizeof(update), __func__);
+    }
+
+    void uring::register_file_alloc_range(unsigned offset, unsigned length)
+    {
+        io_uring_file_index_range range = {};
+        range.off = offset;
+        range.len = length;
+        do_register(IORING_REGISTER_FILE_ALLOC_RANGE, &range, 0, __func__);
+    }
+
+    void uring::unregister_files()
+    {
+        do_register(IORING_UNREGISTER_FILES, nullptr, 0, __func__);
+    }
+
+    void uring::enable()
+    {
+        if (!(flags_ & IORING_SETUP_R_DISABLED))
+            return;
+
+        do_register(IORING_REGISTER_ENABLE_RINGS, nullptr, 0, __func__);
+        flags_ &= ~IORING_SETUP_R_DISABLED;
+    }
+
+    void uring::do_register(unsigned opcode, const void *arg, unsigned nr_args, const char *what)
+    {
+        if (io_uring_register(fd_, opcode, arg, nr_args) < 0)
+            throw std::system_error(errno, std::system_category(), what);
+    }
+
+    int uring::enter(unsigned min_complete, unsigned flags, const __kernel_timespec *timeout)
     {
-        if (io_uring_enter(fd_, 0, 0, IORING_ENTER_SQ_WAKEUP) < 0)
+        unsigned to_submit = 0;
+        if (!(flags_ & IORING_SETUP_SQPOLL))
+            to_submit = sq_flushed_ - sq_entered_;
+
+#if IORING_ENABLE_STATS
+        ++stats_.enter_calls;
+        if (flags & IORING_ENTER_SQ_WAKEUP)
+            ++stats_.sqpoll_wakeups;
+        if ((flags & IORING_ENTER_GETEVENTS) && min_complete > 0)
+            ++stats_.blocking_waits;
+#endif
+
+        int ret;
+        if (timeout)
+        {
+            if (!(features_ & IORING_FEAT_EXT_ARG))
+                throw std::system_error(std::make_error_code(std::errc::operation_not_supported), __func__);
+
+            io_uring_getevents_arg arg = {};
+            arg.ts = reinterpret_cast<__u64>(timeout);
+            ret = io_uring_enter(fd_, to_submit, min_complete, flags | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+        }
+        else
+            ret = io_uring_enter(fd_, to_submit, min_complete, flags);
+
+        if (ret < 0)
+        {
+            if (errno == EINTR || errno == ETIME)
+                return 0;
             throw std::system_error(errno, std::system_category(), __func__);
+        }
+
+        if (!(flags_ & IORING_SETUP_SQPOLL))
+            sq_entered_ += static_cast<unsigned>(ret);
+        return ret;
+    }
+
+    // Detached SQEs do not count as work, so the handlers that ran last can
+    // leave some published but never entered. IORING_ENTER_GETEVENTS also
+    // runs the task work that issues the SQEs linked behind them.
+    void uring::enter_flushed()
+    {
+        if (!(flags_ & IORING_SETUP_SQPOLL) && sq_entered_ != sq_flushed_)
+            enter(0, IORING_ENTER_GETEVENTS);
+    }
+
+    void uring::wakeup()
+    {
+        enter(0, IORING_ENTER_SQ_WAKEUP);
     }
 
     void uring::wait()
     {
-        if (io_uring_enter(fd_, 0, 0, IORING_ENTER_SQ_WAIT) < 0)
-            throw std::system_error(errno, std::system_category(), __func__);
+        if (flags_ & IORING_SETUP_SQPOLL)
+            enter(0, IORING_ENTER_SQ_WAIT);
+        else
+            enter(0, 0);
     }
 
-    void uring::wait_complete()
+    bool uring::ready() const noexcept
     {
-        if (io_uring_enter(fd_, 0, 1, IORING_ENTER_GETEVENTS) < 0)
-            throw std::system_error(errno, std::system_category(), __func__);
+        return cqring_.head->load(std::memory_order_relaxed) != cqring_.tail->load(std::memory_order_acquire) ||
+               posted_count_.load(std::memory_order_acquire) > 0 ||
+               local_head_ ||
+               cq_overflowed();
+    }
+
+    void uring::wait_complete(const std::chrono::steady_clock::time_point *deadline)
+    {
+        using clock = std::chrono::steady_clock;
+
+        // The ring's own completions can queue handlers, such as expired
+        // timers, without posting a CQE for them.
+        if (ready())
+            return;
+
+        if (wait_.spin.count() > 0)
+        {
+            clock::time_point until = clock::now() + std::chrono::duration_cast<clock::duration>(wait_.spin);
+            if (deadline && *deadline < until)
+                until = *deadline;
+
+            // Rings without SQPOLL still have to hand their SQEs over, and
+            // cooperative task work only runs from inside io_uring_enter.
+            bool enter_to_poll = flags_ & (IORING_SETUP_DEFER_TASKRUN | IORING_SETUP_COOP_TASKRUN);
+            if (!(flags_ & IORING_SETUP_SQPOLL) && sq_entered_ != sq_flushed_)
+                enter(0, enter_to_poll ? IORING_ENTER_GETEVENTS : 0);
+            do
+            {
+                if (ready())
+                    return;
+                if (enter_to_poll)
+                    enter(0, IORING_ENTER_GETEVENTS);
+                else
+                {
+#if defined(__x86_64__) || defined(__i386__)
+                    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+                    asm volatile("yield");
+#endif
+                }
+            } while (clock::now() < until);
+
+            if (ready())
+                return;
+        }
+
+        if (!deadline && wait_.min_complete <= 1)
+        {
+            enter(1, IORING_ENTER_GETEVENTS);
+            return;
+        }
+
+        clock::duration timeout = clock::duration::max();
+        if (wait_.min_complete > 1)
+            timeout = std::chrono::duration_cast<clock::duration>(wait_.batch_timeout);
+        if (deadline)
+        {
+            clock::duration left = *deadline - clock::now();
+            if (left <= clock::duration::zero())
+                return;
+            if (left < timeout)
+                timeout = left;
+        }
+
+        std::chrono::nanoseconds ns = std::chrono::duration_cast<std::chrono::nanoseconds>(timeout);
+        __kernel_timespec ts;
+        ts.tv_sec = ns.count() / 1000000000;
+        ts.tv_nsec = ns.count() % 1000000000;
+        enter(wait_.min_complete > 1 ? wait_.min_complete : 1, IORING_ENTER_GETEVENTS, &ts);
     }
 
+    // Makes the ring current on the calling thread for the duration of a
+    // run call, and keeps the read on the wakeup eventfd armed.
+    struct uring::run_scope
+    {
+        explicit run_scope(uring &ring)
+            : outer(current())
+        {
+            current() = &ring;
+            if (!ring.wake_armed_)
+                ring.arm_wake();
+        }
+
+        ~run_scope()
+        {
+            current() = outer;
+        }
+
+        uring *outer;
+    };
+
     void uring::run()
     {
-        while (pending_ > 0)
+        run_scope scope(*this);
+
+        while (has_work())
+        {
+            if (reap(~0u) == 0)
+                wait_complete(nullptr);
+        }
+        enter_flushed();
+    }
+
+    std::size_t uring::poll()
+    {
+        run_scope scope(*this);
+
+        std::size_t n = reap(~0u);
+        if (n == 0 && !(flags_ & IORING_SETUP_SQPOLL))
+        {
+            // Submits what is queued and runs deferred task work.
+            enter(0, IORING_ENTER_GETEVENTS);
+            n = reap(~0u);
+        }
+        enter_flushed();
+        return n;
+    }
+
+    std::size_t uring::run_one()
+    {
+        run_scope scope(*this);
+
+        std::size_t n = 0;
+        while (has_work())
+        {
+            if (reap(1) > 0)
+            {
+                n = 1;
+                break;
+            }
+            wait_complete(nullptr);
+        }
+        enter_flushed();
+        return n;
+    }
+
+    std::size_t uring::run_until(std::chrono::steady_clock::time_point deadline)
+    {
+        run_scope scope(*this);
+
+        std::size_t n = 0;
+        while (has_work())
+        {
+            unsigned reaped = reap(~0u);
+            n += reaped;
+            if (std::chrono::steady_clock::now() >= deadline)
+                break;
+            if (reaped == 0)
+                wait_complete(&deadline);
+        }
+        enter_flushed();
+        return n;
+    }
+
+    void uring::enqueue(operation *op)
+    {
+        if (running_in_this_thread())
+        {
+            op->next = nullptr;
+            if (local_tail_)
+                local_tail_->next = op;
+            else
+                local_head_ = op;
+            local_tail_ = op;
+            return;
+        }
+
+        posted_count_.fetch_add(1, std::memory_order_relaxed);
+
+        operation *head = posted_.load(std::memory_order_relaxed);
+        do
+        {
+            op->next = head;
+        } while (!posted_.compare_exchange_weak(head, op, std::memory_order_release,
+                                                std::memory_order_relaxed));
+
+        if (!wake_requested_.exchange(true))
+        {
+            __u64 one = 1;
+            if (::write(wake_fd_, &one, sizeof(one)) < 0 && errno != EAGAIN)
+                throw std::system_error(errno, std::system_category(), __func__);
+        }
+    }
+
+    unsigned uring::run_posted(unsigned limit)
+    {
+        if (!posted_ready_)
+        {
+            if (!posted_.load(std::memory_order_relaxed))
+                return 0;
+
+            operation *op = posted_.exchange(nullptr, std::memory_order_acquire);
+            while (op)
+            {
+                operation *next = op->next;
+                op->next = posted_ready_;
+                posted_ready_ = op;
+                op = next;
+            }
+        }
+
+        unsigned n = 0;
+        submission_batch batch(*this);
+        while (posted_ready_ && n < limit)
+        {
+            operation *op = posted_ready_;
+            posted_ready_ = op->next;
+            posted_count_.fetch_sub(1, std::memory_order_release);
+            complete_posted(op);
+            ++n;
+        }
+        return n;
+    }
+
+    unsigned uring::run_local(unsigned limit)
+    {
+        if (!local_head_)
+            return 0;
+
+        if (limit > local_run_chunk)
+            limit = local_run_chunk;
+
+        // Operations the handlers below enqueue wait for the next call.
+        operation *last = local_tail_;
+        unsigned n = 0;
+        submission_batch batch(*this);
+        bool end = false;
+        while (!end && local_head_ && n < limit)
+        {
+            operation *op = local_head_;
+            local_head_ = op->next;
+            if (!local_head_)
+                local_tail_ = nullptr;
+            end = op == last;
+            ++n;
+            complete_posted(op);
+        }
+        local_since_enter_ += n;
+        return n;
+    }
+
+    void uring::complete_posted(operation *op)
+    {
+        io_uring_cqe cqe = {};
+        cqe.user_data = reinterpret_cast<__u64>(static_cast<void *>(op));
+        cqe.res = op->result;
+#if IORING_ENABLE_STATS
+        ++stats_.posted;
+#endif
+#if IORING_ENABLE_TRACING
+        trace_completion(op, &cqe);
+#else
+        op->complete(&cqe);
+#endif
+    }
+
+    void uring::arm_wake()
+    {
+        submit([&](io_uring_sqe *sqe)
+               {
+                memset(sqe, 0, sizeof(*sqe));
+                sqe->opcode = IORING_OP_READ;
+                sqe->fd = wake_fd_;
+                sqe->addr = reinterpret_cast<__u64>(&wake_value_);
+                sqe->len = sizeof(wake_value_);
+                sqe->user_data = reinterpret_cast<__u64>(static_cast<void *>(&wake_op_)); });
+        wake_armed_ = true;
+    }
+
+    void uring::wake_complete(io_uring_cqe *cqe)
+    {
+        uring *ring = static_cast<ring_operation *>(reinterpret_cast<void *>(cqe->user_data))->ring;
+        ring->wake_armed_ = false;
+
+        // Later enqueue() calls must signal again; anything pushed before
+        // this point is picked up by the next run_posted(). A failed read
+        // (such as one cancelled by an IORING_ASYNC_CANCEL_ANY) is re-armed
+        // too, or those signals would go unnoticed.
+        ring->wake_requested_.store(false);
+        ring->arm_wake();
+    }
+
+    void uring::schedule_timer(timer_wheel::entry &timer, std::chrono::steady_clock::time_point expiry)
+    {
+        timers_.remove(&timer);
+        timers_.rebase(timer_wheel::now_tick());
+        timers_.add(&timer, timer_wheel::to_tick(expiry));
+
+        std::uint64_t tick = timers_.next_tick();
+        if (!timeout_armed_ || tick < timeout_tick_)
+            arm_timeout(tick);
+    }
+
+    void uring::cancel_timer(timer_wheel::entry &timer) noexcept
+    {
+        timers_.remove(&timer);
+    }
+
+    void uring::arm_timeout(std::uint64_t tick)
+    {
+        timeout_ts_.tv_sec = static_cast<__s64>(tick / 1000);
+        timeout_ts_.tv_nsec = static_cast<long long>(tick % 1000) * 1000000;
+
+        if (timeout_armed_)
         {
-            complete();
+            // Moves the armed timeout in place; if it has already fired
+            // this fails with ENOENT and its CQE re-arms.
+            submit_detached(detached_op::cancel, -1, [&](io_uring_sqe *sqe)
+                            {
+                    memset(sqe, 0, sizeof(*sqe));
+                    sqe->opcode = IORING_OP_TIMEOUT_REMOVE;
+                    sqe->addr = reinterpret_cast<__u64>(static_cast<void *>(&timeout_op_));
+                    sqe->addr2 = reinterpret_cast<__u64>(&timeout_ts_);
+                    sqe->timeout_flags = IORING_TIMEOUT_UPDATE | IORING_TIMEOUT_ABS; });
         }
+        else
+        {
+            submit([&](io_uring_sqe *sqe)
+                   {
+                    memset(sqe, 0, sizeof(*sqe));
+                    sqe->opcode = IORING_OP_TIMEOUT;
+                    sqe->addr = reinterpret_cast<__u64>(&timeout_ts_);
+                    sqe->len = 1;
+                    sqe->timeout_flags = IORING_TIMEOUT_ABS;
+                    sqe->user_data = reinterpret_cast<__u64>(static_cast<void *>(&timeout_op_)); });
+        }
+        timeout_armed_ = true;
+        timeout_tick_ = tick;
+    }
+
+    void uring::timeout_complete(io_uring_cqe *cqe)
+    {
+        uring *ring = static_cast<ring_operation *>(reinterpret_cast<void *>(cqe->user_data))->ring;
+        ring->timeout_armed_ = false;
+
+        // Expired waiters go to the local queue, as cancelled ones do, so a
+        // handler that throws cannot strand the ones behind it.
+        ring->timers_.advance(timer_wheel::now_tick(), [&](timer_wheel::entry *e)
+                              {
+                operation *fifo = nullptr;
+                for (operation *op = e->waiters; op;)
+                {
+                    operation *next = op->next;
+                    op->next = fifo;
+                    fifo = op;
+                    op = next;
+                }
+                e->waiters = nullptr;
+
+                while (fifo)
+                {
+                    operation *next = fifo->next;
+                    fifo->result = 0;
+                    ring->enqueue(fifo);
+                    fifo = next;
+                } });
+
+        if (!ring->timers_.empty())
+            ring->arm_timeout(ring->timers_.next_tick());
     }
 }
 
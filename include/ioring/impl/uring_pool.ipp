@@ -0,0 +1,84 @@
+#ifndef IORING_IMPL_URING_POOL_IPP
+#define IORING_IMPL_URING_POOL_IPP
+
+#include <ioring/uring_pool.hpp>
+
+#include <cerrno>
+#include <exception>
+#include <system_error>
+#include <thread>
+
+#include <pthread.h>
+#include <sched.h>
+
+namespace ioring
+{
+
+    uring_pool::uring_pool(std::size_t size, int queue_depth, const uring::options &opts)
+        : next_(0)
+    {
+        // A single-issuer ring belongs to the task that enables it, so hold
+        // it disabled until its worker thread starts.
+        uring::options ring_opts = opts;
+        if ((ring_opts.flags & IORING_SETUP_SINGLE_ISSUER) && !(ring_opts.flags & IORING_SETUP_SQPOLL))
+            ring_opts.flags |= IORING_SETUP_R_DISABLED;
+
+        if (size == 0)
+            size = 1;
+
+        rings_.reserve(size);
+        for (std::size_t i = 0; i < size; ++i)
+            rings_.emplace_back(new uring(queue_depth, ring_opts));
+    }
+
+    void uring_pool::run()
+    {
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        if (::sched_getaffinity(0, sizeof(allowed), &allowed) < 0)
+            throw std::system_error(errno, std::system_category(), "sched_getaffinity");
+
+        // Allowed CPUs need not be contiguous, nor start at 0.
+        std::vector<int> cpus;
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+            if (CPU_ISSET(cpu, &allowed))
+                cpus.push_back(cpu);
+
+        std::vector<std::thread> threads;
+        std::vector<std::exception_ptr> errors(rings_.size());
+        threads.reserve(rings_.size());
+
+        for (std::size_t i = 0; i < rings_.size(); ++i)
+        {
+            int cpu = cpus[i % cpus.size()];
+            threads.emplace_back([this, i, cpu, &errors]
+                                 {
+                    try
+                    {
+                        cpu_set_t set;
+                        CPU_ZERO(&set);
+                        CPU_SET(cpu, &set);
+                        int err = ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set);
+                        if (err != 0)
+                            throw std::system_error(err, std::system_category(), "pthread_setaffinity_np");
+
+                        rings_[i]->enable();
+                        rings_[i]->run();
+                    }
+                    catch (...)
+                    {
+                        errors[i] = std::current_exception();
+                    } });
+        }
+
+        for (auto &t : threads)
+            t.join();
+
+        for (auto &e : errors)
+            if (e)
+                std::rethrow_exception(e);
+    }
+
+}
+
+#endif /* IORING_IMPL_URING_POOL_IPP */
@@ -3,6 +3,8 @@
 
 #include <ioring/config.hpp>
 
+#include <cstddef>
+
 #include <linux/io_uring.h>
 
 namespace ioring
@@ -11,6 +13,11 @@ namespace ioring
     IORING_DECL int io_uring_enter(int ring_fd, unsigned int to_submit,
                                    unsigned int min_complete, unsigned int flags);
 
+    // With IORING_ENTER_EXT_ARG in `flags`, `arg` is an io_uring_getevents_arg.
+    IORING_DECL int io_uring_enter(int ring_fd, unsigned int to_submit,
+                                   unsigned int min_complete, unsigned int flags,
+                                   const void *arg, std::size_t argsz);
+
 } // namespace ioring
 
 #include <ioring/impl/io_uring_enter.ipp>
@@ -0,0 +1,18 @@
+#ifndef IORING_IO_URING_REGISTER_HPP
+#define IORING_IO_URING_REGISTER_HPP
+
+#include <ioring/config.hpp>
+
+#include <linux/io_uring.h>
+
+namespace ioring
+{
+
+    IORING_DECL int io_uring_register(int ring_fd, unsigned int opcode,
+                                      const void *arg, unsigned int nr_args);
+
+} // namespace ioring
+
+#include <ioring/impl/io_uring_register.ipp>
+
+#endif /* IORING_IO_URING_REGISTER_HPP */
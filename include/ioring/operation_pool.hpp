@@ -0,0 +1,71 @@
+#ifndef IORING_OPERATION_POOL_HPP
+#define IORING_OPERATION_POOL_HPP
+
+#include <ioring/config.hpp>
+
+#include <cstddef>
+#include <new>
+
+namespace ioring
+{
+
+    // Size-class free lists for operation storage. Blocks are never returned
+    // to the global heap while the pool is alive, so once the pool has warmed
+    // up every submit/complete cycle reuses memory. Not thread-safe.
+    class operation_pool
+    {
+    public:
+        static constexpr std::size_t granularity = 16;
+        static constexpr std::size_t max_cached_size = 512;
+
+        operation_pool() noexcept = default;
+
+        operation_pool(const operation_pool &) = delete;
+        operation_pool &operator=(const operation_pool &) = delete;
+
+        IORING_DECL ~operation_pool();
+
+        void *allocate(std::size_t size, std::size_t align = alignof(std::max_align_t))
+        {
+            if (size > max_cached_size || align > alignof(std::max_align_t))
+                return ::operator new(size, std::align_val_t(align));
+
+            std::size_t index = size_class(size);
+            if (block *b = free_[index])
+            {
+                free_[index] = b->next;
+                return b;
+            }
+            return ::operator new((index + 1) * granularity);
+        }
+
+        void deallocate(void *p, std::size_t size, std::size_t align = alignof(std::max_align_t)) noexcept
+        {
+            if (size > max_cached_size || align > alignof(std::max_align_t))
+                return ::operator delete(p, std::align_val_t(align));
+
+            std::size_t index = size_class(size);
+            block *b = static_cast<block *>(p);
+            b->next = free_[index];
+            free_[index] = b;
+        }
+
+    private:
+        struct block
+        {
+            block *next;
+        };
+
+        static std::size_t size_class(std::size_t size) noexcept
+        {
+            return size == 0 ? 0 : (size - 1) / granularity;
+        }
+
+        block *free_[max_cached_size / granularity] = {};
+    };
+
+}
+
+#include <ioring/impl/operation_pool.ipp>
+
+#endif /* IORING_OPERATION_POOL_HPP */
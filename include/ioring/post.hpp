@@ -2,8 +2,10 @@
 #define IORING_POST_HPP
 
 #include <ioring/uring.hpp>
+#include <ioring/async_result.hpp>
 
 #include <cstring>
+#include <memory>
 #include <system_error>
 
 namespace ioring
@@ -29,16 +31,99 @@ namespace ioring
         typename std::decay<Handler>::type handler;
     };
 
+    // Runs the handler later on the thread running the ring, as
+    // handler(std::error_code). Safe to call from any thread. On the ring's
+    // own thread the handler goes to the ring's local run queue and never
+    // reaches the kernel; other threads hand it over through the ring's
+    // lock-free queue.
     template <typename Handler>
-    void post(uring &ring, Handler &&h)
+    async_return_t<Handler, void(std::error_code)>
+    post(uring &ring, Handler &&h)
     {
-        ring.submit([&](io_uring_sqe *sqe)
-                    {
-                memset(sqe, 0, sizeof(*sqe));
-                sqe->opcode = IORING_OP_NOP;
-                sqe->user_data = wrapped_operation<post_op<Handler>>::create(
-                    ring,
-                    std::forward<Handler>(h)); });
+        return async_initiate<void(std::error_code)>(
+            [&ring](auto &&h)
+            {
+                using H = decltype(h);
+                __u64 op = ring.running_in_this_thread()
+                               ? wrapped_operation<post_op<H>>::create(
+                                     get_associated_allocator(h, ring.get_allocator()),
+                                     ring,
+                                     std::forward<H>(h))
+                               : wrapped_operation<post_op<H>>::create(
+                                     get_associated_allocator(h, std::allocator<void>()),
+                                     ring,
+                                     std::forward<H>(h));
+                ring.enqueue(static_cast<operation *>(reinterpret_cast<void *>(op)));
+            },
+            std::forward<Handler>(h));
+    }
+
+    struct kernel_round_trip_t
+    {
+        explicit constexpr kernel_round_trip_t() = default;
+    };
+
+    constexpr kernel_round_trip_t kernel_round_trip{};
+
+    // Like post(), but on the ring's thread the handler rides an
+    // IORING_OP_NOP and runs from its CQE, after the completions the kernel
+    // posted before it.
+    template <typename Handler>
+    async_return_t<Handler, void(std::error_code)>
+    post(uring &ring, kernel_round_trip_t, Handler &&h)
+    {
+        return async_initiate<void(std::error_code)>(
+            [&ring](auto &&h)
+            {
+                using H = decltype(h);
+                if (!ring.running_in_this_thread())
+                {
+                    post(ring, std::forward<H>(h));
+                    return;
+                }
+
+                ring.submit([&](io_uring_sqe *sqe)
+                            {
+                        memset(sqe, 0, sizeof(*sqe));
+                        sqe->opcode = IORING_OP_NOP;
+                        sqe->user_data = wrapped_operation<post_op<H>>::create(
+                            get_associated_allocator(h, ring.get_allocator()),
+                            ring,
+                            std::forward<H>(h)); });
+            },
+            std::forward<Handler>(h));
+    }
+
+    // Queues the handler like post(). Meant for continuations of the
+    // running handler: it runs once the caller has returned, after the
+    // handlers already queued.
+    template <typename Handler>
+    async_return_t<Handler, void(std::error_code)>
+    defer(uring &ring, Handler &&h)
+    {
+        return post(ring, std::forward<Handler>(h));
+    }
+
+    // Runs the handler immediately when called on the ring's thread,
+    // otherwise behaves like post().
+    template <typename Handler>
+    async_return_t<Handler, void(std::error_code)>
+    dispatch(uring &ring, Handler &&h)
+    {
+        return async_initiate<void(std::error_code)>(
+            [&ring](auto &&h)
+            {
+                using H = decltype(h);
+                if (ring.running_in_this_thread())
+                {
+                    typename std::decay<H>::type handler(std::forward<H>(h));
+                    handler(std::error_code());
+                    return;
+                }
+
+                post(ring, std::forward<H>(h));
+            },
+            std::forward<Handler>(h));
     }
 
 }
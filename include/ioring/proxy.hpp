@@ -0,0 +1,288 @@
+#ifndef IORING_PROXY_HPP
+#define IORING_PROXY_HPP
+
+#include <ioring/uring.hpp>
+#include <ioring/descriptor.hpp>
+#include <ioring/socket_base.hpp>
+
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <system_error>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace ioring
+{
+
+    // State of async_proxy: one pipe per direction, and the operations of
+    // the poll and splices in flight, so relaying a chunk allocates nothing.
+    template <typename Handler, typename Allocator>
+    class proxy_operation
+    {
+    public:
+        using allocator_type = typename std::allocator_traits<Allocator>::template rebind_alloc<proxy_operation>;
+
+        // Default pipe capacity: a full chunk never blocks the first splice.
+        static constexpr std::size_t chunk_size = 65536;
+
+        template <typename H>
+        proxy_operation(const Allocator &alloc, uring &ring,
+                        const descriptor &a, bool a_is_socket,
+                        const descriptor &b, bool b_is_socket, H &&h)
+            : ring_(ring),
+              dirs_{{ring, a, b, b_is_socket}, {ring, b, a, a_is_socket}},
+              alloc_(alloc),
+              handler_(std::forward<H>(h))
+        {
+            for (unsigned d = 0; d < 2; ++d)
+            {
+                for (unsigned i = 0; i < 3; ++i)
+                {
+                    dirs_[d].links[i].complete = link_complete;
+                    dirs_[d].links[i].owner = this;
+                    dirs_[d].links[i].dir = d;
+                    dirs_[d].links[i].index = i;
+                }
+            }
+        }
+
+        void start()
+        {
+            submission_batch batch(ring_);
+            ring_.reserve(6);
+            step(0);
+            step(1);
+        }
+
+    private:
+        struct link : operation
+        {
+            proxy_operation *owner;
+            unsigned dir;
+            unsigned index;
+        };
+
+        struct direction
+        {
+            direction(uring &ring, const descriptor &from, const descriptor &to, bool shutdown_to)
+                : from(from), to(to), pipe_r(ring), pipe_w(ring), shutdown_to(shutdown_to)
+            {
+                int fds[2];
+                if (::pipe2(fds, O_CLOEXEC) < 0)
+                    throw std::system_error(errno, std::system_category(), "async_proxy");
+                pipe_r.assign(fds[0]);
+                pipe_w.assign(fds[1]);
+            }
+
+            const descriptor &from;
+            const descriptor &to;
+            descriptor pipe_r;
+            descriptor pipe_w;
+            bool shutdown_to;
+            bool paired = false;
+            unsigned inflight = 0;
+            std::size_t pending = 0;
+            // Poll, splice into the pipe, splice out of it.
+            int res[3] = {};
+            link links[3];
+        };
+
+        static __u64 user_data(link &l) noexcept
+        {
+            return reinterpret_cast<__u64>(static_cast<operation *>(&l));
+        }
+
+        // Bytes left in the pipe are flushed on their own; otherwise a chunk
+        // is spliced in and, linked, out again. A short first splice breaks
+        // the link and what it moved is flushed by the next step. SPLICE
+        // always runs on an io-wq worker, which would sit blocked in a read
+        // from an idle peer; a linked poll holds the chunk back until `from`
+        // is readable instead.
+        void step(unsigned d)
+        {
+            direction &dir = dirs_[d];
+            submission_batch batch(ring_);
+
+            if (dir.pending > 0)
+            {
+                ring_.submit([&](io_uring_sqe *sqe)
+                             {
+                        prepare_splice(sqe, IORING_OP_SPLICE, dir.pipe_r, dir.to, dir.pending);
+                        sqe->user_data = user_data(dir.links[2]); });
+                dir.paired = false;
+                dir.inflight = 1;
+                return;
+            }
+
+            ring_.reserve(3);
+            ring_.submit([&](io_uring_sqe *sqe)
+                         {
+                    memset(sqe, 0, sizeof(*sqe));
+                    sqe->opcode = IORING_OP_POLL_ADD;
+                    dir.from.prepare_fd(sqe);
+                    sqe->poll32_events = POLLIN;
+                    sqe->flags |= IOSQE_IO_LINK;
+                    sqe->user_data = user_data(dir.links[0]); });
+            ring_.submit([&](io_uring_sqe *sqe)
+                         {
+                    prepare_splice(sqe, IORING_OP_SPLICE, dir.from, dir.pipe_w, chunk_size);
+                    sqe->flags |= IOSQE_IO_LINK;
+                    sqe->user_data = user_data(dir.links[1]); });
+            ring_.submit([&](io_uring_sqe *sqe)
+                         {
+                    prepare_splice(sqe, IORING_OP_SPLICE, dir.pipe_r, dir.to, chunk_size);
+                    sqe->user_data = user_data(dir.links[2]); });
+            dir.paired = true;
+            dir.inflight = 3;
+        }
+
+        static void link_complete(io_uring_cqe *cqe)
+        {
+            link *l = static_cast<link *>(reinterpret_cast<operation *>(cqe->user_data));
+            proxy_operation *self = l->owner;
+            direction &dir = self->dirs_[l->dir];
+            dir.res[l->index] = cqe->res;
+            if (--dir.inflight == 0)
+                self->advance(l->dir);
+        }
+
+        void advance(unsigned d)
+        {
+            direction &dir = dirs_[d];
+            int out = dir.res[2];
+            bool eof = false;
+
+            if (dir.paired)
+            {
+                if (dir.res[0] < 0)
+                    return fail(d, dir.res[0]);
+                int in = dir.res[1];
+                if (in < 0)
+                    return fail(d, in);
+                if (out == -ECANCELED)
+                    out = 0;
+                if (out < 0)
+                    return fail(d, out);
+                dir.pending = in - out;
+                eof = in == 0;
+            }
+            else
+            {
+                if (out < 0)
+                    return fail(d, out);
+                dir.pending -= out;
+            }
+
+            if (eof)
+            {
+                if (dir.shutdown_to)
+                {
+                    ring_.submit_detached(detached_op::shutdown, dir.to.native_handle(), [&](io_uring_sqe *sqe)
+                                          {
+                            memset(sqe, 0, sizeof(*sqe));
+                            sqe->opcode = IORING_OP_SHUTDOWN;
+                            dir.to.prepare_fd(sqe);
+                            sqe->len = SHUT_WR; });
+                }
+                return finish();
+            }
+
+            if (ec_)
+                return finish();
+
+            step(d);
+        }
+
+        // The first error stops the other direction too.
+        void fail(unsigned d, int res)
+        {
+            if (!ec_)
+            {
+                ec_ = std::error_code(-res, std::system_category());
+
+                direction &other = dirs_[d ^ 1];
+                if (other.inflight > 0)
+                {
+                    for (link &l : other.links)
+                    {
+                        ring_.submit_detached(detached_op::cancel, -1, [&](io_uring_sqe *sqe)
+                                              {
+                                memset(sqe, 0, sizeof(*sqe));
+                                sqe->opcode = IORING_OP_ASYNC_CANCEL;
+                                sqe->addr = user_data(l); });
+                    }
+                }
+            }
+            finish();
+        }
+
+        void finish()
+        {
+            if (--running_ > 0)
+                return;
+
+            allocator_type a(alloc_);
+            Handler h(std::move(handler_));
+            std::error_code ec = ec_;
+            this->~proxy_operation();
+            a.deallocate(this, 1);
+            h(ec);
+        }
+
+        uring &ring_;
+        direction dirs_[2];
+        unsigned running_ = 2;
+        std::error_code ec_;
+        Allocator alloc_;
+        Handler handler_;
+    };
+
+    // Relays data both ways between `a` and `b` until each side reaches end
+    // of file. Every chunk is spliced into a pipe and, in a linked SQE, out
+    // of it again, so the payload never enters user space. A socket is
+    // shut down for writing once the other side has ended. The first error
+    // stops both directions; handler(std::error_code) runs when both have
+    // finished. Shutting `a` and `b` down ends the proxy early; cancelling
+    // or closing them does not reliably, as the splices are submitted
+    // against the pipes. Both must outlive the handler.
+    template <typename StreamA, typename StreamB, typename Handler>
+    async_return_t<Handler, void(std::error_code)>
+    async_proxy(StreamA &a, StreamB &b, Handler &&handler)
+    {
+        return async_initiate<void(std::error_code)>(
+            [&a, &b](auto &&handler)
+            {
+                using H = typename std::decay<decltype(handler)>::type;
+                using allocator_type = typename associated_allocator<H, recycling_allocator<void>>::type;
+                using op_type = proxy_operation<H, allocator_type>;
+
+                uring &ring = a.get_uring();
+                allocator_type alloc = get_associated_allocator(handler, ring.get_allocator());
+                typename op_type::allocator_type op_alloc(alloc);
+                op_type *op = op_alloc.allocate(1);
+                try
+                {
+                    ::new (static_cast<void *>(op)) op_type(
+                        alloc, ring,
+                        a, std::is_base_of<socket_base, StreamA>::value,
+                        b, std::is_base_of<socket_base, StreamB>::value,
+                        std::forward<decltype(handler)>(handler));
+                }
+                catch (...)
+                {
+                    op_alloc.deallocate(op, 1);
+                    throw;
+                }
+                op->start();
+            },
+            std::forward<Handler>(handler));
+    }
+
+}
+
+#endif /* IORING_PROXY_HPP */
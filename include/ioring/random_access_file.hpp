@@ -0,0 +1,446 @@
+#ifndef IORING_RANDOM_ACCESS_FILE_HPP
+#define IORING_RANDOM_ACCESS_FILE_HPP
+
+#include <ioring/descriptor.hpp>
+#include <ioring/buffers.hpp>
+#include <ioring/post.hpp>
+#include <ioring/vectored.hpp>
+
+#include <cstdint>
+#include <limits>
+
+#include <fcntl.h>
+#include <sys/types.h>
+
+namespace ioring
+{
+
+    // A regular file read and written at explicit offsets. Files opened
+    // with O_DIRECT check every transfer against the alignment the file
+    // system reports and throw std::system_error with
+    // std::errc::invalid_argument for a misaligned buffer, size or offset.
+    class random_access_file
+        : public descriptor
+    {
+    public:
+        explicit random_access_file(uring &ring)
+            : descriptor(ring), direct_io_(false), memory_alignment_(1), offset_alignment_(1)
+        {
+        }
+
+        random_access_file(uring &ring, const char *path, int flags, mode_t mode = 0644)
+            : random_access_file(ring)
+        {
+            open(path, flags, mode);
+        }
+
+        IORING_DECL void open(const char *path, int flags, mode_t mode = 0644);
+
+        // Adopts an open file; O_DIRECT is taken from its status flags.
+        IORING_DECL void assign(int fd);
+
+        // Opens the file with IORING_OP_OPENAT. `path` must stay valid
+        // until the handler runs.
+        template <typename Handler>
+        async_return_t<Handler, void(std::error_code)>
+        async_open(const char *path, int flags, mode_t mode, Handler &&handler);
+
+        bool direct_io() const noexcept
+        {
+            return direct_io_;
+        }
+
+        // Alignment O_DIRECT transfers need for buffer addresses, and for
+        // sizes and offsets; 1 without O_DIRECT.
+        std::size_t memory_alignment() const noexcept
+        {
+            return memory_alignment_;
+        }
+
+        std::size_t offset_alignment() const noexcept
+        {
+            return offset_alignment_;
+        }
+
+        IORING_DECL void check_alignment(const void *data, std::size_t size, std::uint64_t offset) const;
+
+        template <typename Handler>
+        async_return_t<Handler, void(std::error_code, std::size_t)>
+        async_read_at(std::uint64_t offset, mutable_buffer buffer, Handler &&handler);
+
+        template <typename Handler>
+        async_return_t<Handler, void(std::error_code, std::size_t)>
+        async_read_at(std::uint64_t offset, mutable_registered_buffer buffer, Handler &&handler);
+
+        template <typename MutableBufferSequence, typename Handler>
+        mutable_sequence_return_t<MutableBufferSequence, Handler>
+        async_read_at(std::uint64_t offset, const MutableBufferSequence &buffers, Handler &&handler);
+
+        template <typename Handler>
+        async_return_t<Handler, void(std::error_code, std::size_t)>
+        async_write_at(std::uint64_t offset, const_buffer buffer, Handler &&handler);
+
+        template <typename Handler>
+        async_return_t<Handler, void(std::error_code, std::size_t)>
+        async_write_at(std::uint64_t offset, const_registered_buffer buffer, Handler &&handler);
+
+        template <typename Handler>
+        async_return_t<Handler, void(std::error_code, std::size_t)>
+        async_write_at(std::uint64_t offset, mutable_registered_buffer buffer, Handler &&handler)
+        {
+            return async_write_at(offset, const_registered_buffer(buffer), std::forward<Handler>(handler));
+        }
+
+        template <typename ConstBufferSequence, typename Handler>
+        const_sequence_return_t<ConstBufferSequence, Handler>
+        async_write_at(std::uint64_t offset, const ConstBufferSequence &buffers, Handler &&handler);
+
+        template <typename Handler>
+        async_return_t<Handler, void(std::error_code)> async_fsync(Handler &&handler);
+
+        // Like async_fsync, but skips metadata not needed to read the data.
+        template <typename Handler>
+        async_return_t<Handler, void(std::error_code)> async_fdatasync(Handler &&handler);
+
+        // `mode` takes the FALLOC_FL_* flags of fallocate(2).
+        template <typename Handler>
+        async_return_t<Handler, void(std::error_code)>
+        async_fallocate(int mode, std::uint64_t offset, std::uint64_t length, Handler &&handler);
+
+        // `flags` takes the SYNC_FILE_RANGE_* flags of sync_file_range(2).
+        // A `length` of 0 syncs to the end of the file. The SQE carries 32
+        // bits of length, so a longer range completes with
+        // std::errc::invalid_argument instead of syncing a shorter one.
+        template <typename Handler>
+        async_return_t<Handler, void(std::error_code)>
+        async_sync_file_range(std::uint64_t offset, std::uint64_t length, unsigned flags, Handler &&handler);
+
+    private:
+        IORING_DECL void opened(int flags);
+
+        template <typename Buffers>
+        void check_alignment(const Buffers &buffers, std::uint64_t offset) const
+        {
+            if (!direct_io_)
+                return;
+            for (auto i = buffer_sequence_begin(buffers), e = buffer_sequence_end(buffers); i != e; ++i)
+            {
+                const_buffer buffer(*i);
+                check_alignment(buffer.data(), buffer.size(), offset);
+            }
+        }
+
+        bool direct_io_;
+        std::size_t memory_alignment_;
+        std::size_t offset_alignment_;
+    };
+
+    template <typename Handler>
+    async_return_t<Handler, void(std::error_code)>
+    random_access_file::async_open(const char *path, int flags, mode_t mode, Handler &&handler)
+    {
+        return async_initiate<void(std::error_code)>(
+            [this, path, flags, mode](auto &&handler)
+            {
+                using H = decltype(handler);
+                struct open_op
+                {
+                    open_op(random_access_file &file, int flags, H &&h)
+                        : file_(file), flags_(flags), handler_(std::forward<H>(h))
+                    {
+                    }
+
+                    void operator()(io_uring_cqe *cqe)
+                    {
+                        if (cqe->res < 0)
+                        {
+                            handler_(std::error_code(-cqe->res, std::system_category()));
+                            return;
+                        }
+
+                        file_.descriptor::assign(cqe->res);
+                        file_.opened(flags_);
+                        handler_(std::error_code());
+                    }
+
+                    random_access_file &file_;
+                    int flags_;
+                    typename std::decay<H>::type handler_;
+                };
+
+                get_uring().submit([&](io_uring_sqe *sqe)
+                                   {
+                        memset(sqe, 0, sizeof(*sqe));
+                        sqe->opcode = IORING_OP_OPENAT;
+                        sqe->fd = AT_FDCWD;
+                        sqe->addr = reinterpret_cast<__u64>(path);
+                        sqe->len = mode;
+                        sqe->open_flags = flags | O_CLOEXEC;
+                        cancellation_slot slot = get_associated_cancellation_slot(handler);
+                        sqe->user_data = wrapped_operation<open_op>::create(
+                            get_associated_allocator(handler, get_uring().get_allocator()),
+                            *this, flags, std::forward<H>(handler));
+                        slot.assign(get_uring(), sqe->user_data); });
+            },
+            std::forward<Handler>(handler));
+    }
+
+    template <typename Handler>
+    async_return_t<Handler, void(std::error_code, std::size_t)>
+    random_access_file::async_read_at(std::uint64_t offset, mutable_buffer buffer, Handler &&handler)
+    {
+        check_alignment(buffer, offset);
+        return async_initiate<void(std::error_code, std::size_t)>(
+            [this, offset, buffer](auto &&handler)
+            {
+                using H = decltype(handler);
+                get_uring().submit([&](io_uring_sqe *sqe)
+                                   {
+                        memset(sqe, 0, sizeof(*sqe));
+                        sqe->opcode = IORING_OP_READ;
+                        this->prepare_fd(sqe);
+                        sqe->addr = reinterpret_cast<__u64>(buffer.data());
+                        sqe->len = buffer.size();
+                        sqe->off = offset;
+                        cancellation_slot slot = get_associated_cancellation_slot(handler);
+                        sqe->user_data = wrapped_operation<transfer_op<H>>::create(
+                            get_associated_allocator(handler, get_uring().get_allocator()),
+                            std::forward<H>(handler));
+                        slot.assign(get_uring(), sqe->user_data); });
+            },
+            std::forward<Handler>(handler));
+    }
+
+    template <typename Handler>
+    async_return_t<Handler, void(std::error_code, std::size_t)>
+    random_access_file::async_read_at(std::uint64_t offset, mutable_registered_buffer buffer, Handler &&handler)
+    {
+        check_alignment(mutable_buffer(buffer), offset);
+        return async_initiate<void(std::error_code, std::size_t)>(
+            [this, offset, buffer](auto &&handler)
+            {
+                using H = decltype(handler);
+                get_uring().submit([&](io_uring_sqe *sqe)
+                                   {
+                        memset(sqe, 0, sizeof(*sqe));
+                        sqe->opcode = IORING_OP_READ_FIXED;
+                        this->prepare_fd(sqe);
+                        sqe->addr = reinterpret_cast<__u64>(buffer.data());
+                        sqe->len = buffer.size();
+                        sqe->off = offset;
+                        sqe->buf_index = buffer.buffer_index();
+                        cancellation_slot slot = get_associated_cancellation_slot(handler);
+                        sqe->user_data = wrapped_operation<transfer_op<H>>::create(
+                            get_associated_allocator(handler, get_uring().get_allocator()),
+                            std::forward<H>(handler));
+                        slot.assign(get_uring(), sqe->user_data); });
+            },
+            std::forward<Handler>(handler));
+    }
+
+    template <typename MutableBufferSequence, typename Handler>
+    mutable_sequence_return_t<MutableBufferSequence, Handler>
+    random_access_file::async_read_at(std::uint64_t offset, const MutableBufferSequence &buffers, Handler &&handler)
+    {
+        check_alignment(buffers, offset);
+        return async_initiate<void(std::error_code, std::size_t)>(
+            [this, offset, buffers](auto &&handler)
+            {
+                using H = decltype(handler);
+                submit_vectored<transfer_op<H>>(
+                    get_uring(), buffers, [&](io_uring_sqe *sqe, iovec_state &state)
+                    {
+                        memset(sqe, 0, sizeof(*sqe));
+                        sqe->opcode = IORING_OP_READV;
+                        this->prepare_fd(sqe);
+                        sqe->addr = reinterpret_cast<__u64>(state.iov);
+                        sqe->len = state.count;
+                        sqe->off = offset; },
+                    std::forward<H>(handler));
+            },
+            std::forward<Handler>(handler));
+    }
+
+    template <typename Handler>
+    async_return_t<Handler, void(std::error_code, std::size_t)>
+    random_access_file::async_write_at(std::uint64_t offset, const_buffer buffer, Handler &&handler)
+    {
+        check_alignment(buffer, offset);
+        return async_initiate<void(std::error_code, std::size_t)>(
+            [this, offset, buffer](auto &&handler)
+            {
+                using H = decltype(handler);
+                get_uring().submit([&](io_uring_sqe *sqe)
+                                   {
+                        memset(sqe, 0, sizeof(*sqe));
+                        sqe->opcode = IORING_OP_WRITE;
+                        this->prepare_fd(sqe);
+                        sqe->addr = reinterpret_cast<__u64>(buffer.data());
+                        sqe->len = buffer.size();
+                        sqe->off = offset;
+                        cancellation_slot slot = get_associated_cancellation_slot(handler);
+                        sqe->user_data = wrapped_operation<transfer_op<H>>::create(
+                            get_associated_allocator(handler, get_uring().get_allocator()),
+                            std::forward<H>(handler));
+                        slot.assign(get_uring(), sqe->user_data); });
+            },
+            std::forward<Handler>(handler));
+    }
+
+    template <typename Handler>
+    async_return_t<Handler, void(std::error_code, std::size_t)>
+    random_access_file::async_write_at(std::uint64_t offset, const_registered_buffer buffer, Handler &&handler)
+    {
+        check_alignment(const_buffer(buffer), offset);
+        return async_initiate<void(std::error_code, std::size_t)>(
+            [this, offset, buffer](auto &&handler)
+            {
+                using H = decltype(handler);
+                get_uring().submit([&](io_uring_sqe *sqe)
+                                   {
+                        memset(sqe, 0, sizeof(*sqe));
+                        sqe->opcode = IORING_OP_WRITE_FIXED;
+                        this->prepare_fd(sqe);
+                        sqe->addr = reinterpret_cast<__u64>(buffer.data());
+                        sqe->len = buffer.size();
+                        sqe->off = offset;
+                        sqe->buf_index = buffer.buffer_index();
+                        cancellation_slot slot = get_associated_cancellation_slot(handler);
+                        sqe->user_data = wrapped_operation<transfer_op<H>>::create(
+                            get_associated_allocator(handler, get_uring().get_allocator()),
+                            std::forward<H>(handler));
+                        slot.assign(get_uring(), sqe->user_data); });
+            },
+            std::forward<Handler>(handler));
+    }
+
+    template <typename ConstBufferSequence, typename Handler>
+    const_sequence_return_t<ConstBufferSequence, Handler>
+    random_access_file::async_write_at(std::uint64_t offset, const ConstBufferSequence &buffers, Handler &&handler)
+    {
+        check_alignment(buffers, offset);
+        return async_initiate<void(std::error_code, std::size_t)>(
+            [this, offset, buffers](auto &&handler)
+            {
+                using H = decltype(handler);
+                submit_vectored<transfer_op<H>>(
+                    get_uring(), buffers, [&](io_uring_sqe *sqe, iovec_state &state)
+                    {
+                        memset(sqe, 0, sizeof(*sqe));
+                        sqe->opcode = IORING_OP_WRITEV;
+                        this->prepare_fd(sqe);
+                        sqe->addr = reinterpret_cast<__u64>(state.iov);
+                        sqe->len = state.count;
+                        sqe->off = offset; },
+                    std::forward<H>(handler));
+            },
+            std::forward<Handler>(handler));
+    }
+
+    template <typename Handler>
+    async_return_t<Handler, void(std::error_code)>
+    random_access_file::async_fsync(Handler &&handler)
+    {
+        return async_initiate<void(std::error_code)>(
+            [this](auto &&handler)
+            {
+                using H = decltype(handler);
+                get_uring().submit([&](io_uring_sqe *sqe)
+                                   {
+                        memset(sqe, 0, sizeof(*sqe));
+                        sqe->opcode = IORING_OP_FSYNC;
+                        this->prepare_fd(sqe);
+                        cancellation_slot slot = get_associated_cancellation_slot(handler);
+                        sqe->user_data = wrapped_operation<post_op<typename std::decay<H>::type>>::create(
+                            get_associated_allocator(handler, get_uring().get_allocator()),
+                            get_uring(), std::forward<H>(handler));
+                        slot.assign(get_uring(), sqe->user_data); });
+            },
+            std::forward<Handler>(handler));
+    }
+
+    template <typename Handler>
+    async_return_t<Handler, void(std::error_code)>
+    random_access_file::async_fdatasync(Handler &&handler)
+    {
+        return async_initiate<void(std::error_code)>(
+            [this](auto &&handler)
+            {
+                using H = decltype(handler);
+                get_uring().submit([&](io_uring_sqe *sqe)
+                                   {
+                        memset(sqe, 0, sizeof(*sqe));
+                        sqe->opcode = IORING_OP_FSYNC;
+                        this->prepare_fd(sqe);
+                        sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+                        cancellation_slot slot = get_associated_cancellation_slot(handler);
+                        sqe->user_data = wrapped_operation<post_op<typename std::decay<H>::type>>::create(
+                            get_associated_allocator(handler, get_uring().get_allocator()),
+                            get_uring(), std::forward<H>(handler));
+                        slot.assign(get_uring(), sqe->user_data); });
+            },
+            std::forward<Handler>(handler));
+    }
+
+    template <typename Handler>
+    async_return_t<Handler, void(std::error_code)>
+    random_access_file::async_fallocate(int mode, std::uint64_t offset, std::uint64_t length, Handler &&handler)
+    {
+        return async_initiate<void(std::error_code)>(
+            [this, mode, offset, length](auto &&handler)
+            {
+                using H = decltype(handler);
+                get_uring().submit([&](io_uring_sqe *sqe)
+                                   {
+                        memset(sqe, 0, sizeof(*sqe));
+                        sqe->opcode = IORING_OP_FALLOCATE;
+                        this->prepare_fd(sqe);
+                        sqe->off = offset;
+                        sqe->addr = length;
+                        sqe->len = mode;
+                        cancellation_slot slot = get_associated_cancellation_slot(handler);
+                        sqe->user_data = wrapped_operation<post_op<typename std::decay<H>::type>>::create(
+                            get_associated_allocator(handler, get_uring().get_allocator()),
+                            get_uring(), std::forward<H>(handler));
+                        slot.assign(get_uring(), sqe->user_data); });
+            },
+            std::forward<Handler>(handler));
+    }
+
+    template <typename Handler>
+    async_return_t<Handler, void(std::error_code)>
+    random_access_file::async_sync_file_range(std::uint64_t offset, std::uint64_t length, unsigned flags, Handler &&handler)
+    {
+        return async_initiate<void(std::error_code)>(
+            [this, offset, length, flags](auto &&handler)
+            {
+                using H = decltype(handler);
+                if (length > std::numeric_limits<std::uint32_t>::max())
+                {
+                    post(get_uring(), [h = typename std::decay<H>::type(std::forward<H>(handler))](std::error_code) mutable
+                         { h(std::make_error_code(std::errc::invalid_argument)); });
+                    return;
+                }
+
+                get_uring().submit([&](io_uring_sqe *sqe)
+                                   {
+                        memset(sqe, 0, sizeof(*sqe));
+                        sqe->opcode = IORING_OP_SYNC_FILE_RANGE;
+                        this->prepare_fd(sqe);
+                        sqe->off = offset;
+                        sqe->len = static_cast<__u32>(length);
+                        sqe->sync_range_flags = flags;
+                        cancellation_slot slot = get_associated_cancellation_slot(handler);
+                        sqe->user_data = wrapped_operation<post_op<typename std::decay<H>::type>>::create(
+                            get_associated_allocator(handler, get_uring().get_allocator()),
+                            get_uring(), std::forward<H>(handler));
+                        slot.assign(get_uring(), sqe->user_data); });
+            },
+            std::forward<Handler>(handler));
+    }
+
+}
+
+#include <ioring/impl/random_access_file.ipp>
+
+#endif /* IORING_RANDOM_ACCESS_FILE_HPP */
@@ -0,0 +1,187 @@
+#ifndef IORING_READ_WRITE_HPP
+#define IORING_READ_WRITE_HPP
+
+#include <ioring/buffers.hpp>
+#include <ioring/vectored.hpp>
+#include <ioring/async_result.hpp>
+#include <ioring/associated_allocator.hpp>
+#include <ioring/cancellation.hpp>
+#include <ioring/error.hpp>
+#include <ioring/post.hpp>
+
+#include <cstddef>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+namespace ioring
+{
+
+    // The part of a buffer sequence left after skipping `skip` bytes,
+    // limited to the number of buffers one vectored operation takes.
+    template <typename Buffer>
+    class consuming_buffers
+    {
+    public:
+        template <typename Buffers>
+        consuming_buffers(const Buffers &buffers, std::size_t skip) noexcept
+        {
+            for (auto i = buffer_sequence_begin(buffers), e = buffer_sequence_end(buffers);
+                 i != e && count_ < iovec_state::max_buffers; ++i)
+            {
+                Buffer buffer(*i);
+                if (skip >= buffer.size())
+                {
+                    skip -= buffer.size();
+                    continue;
+                }
+                buffer += skip;
+                skip = 0;
+                buffers_[count_++] = buffer;
+            }
+        }
+
+        const Buffer *begin() const noexcept
+        {
+            return buffers_;
+        }
+
+        const Buffer *end() const noexcept
+        {
+            return buffers_ + count_;
+        }
+
+        bool empty() const noexcept
+        {
+            return count_ == 0;
+        }
+
+        std::size_t size() const noexcept
+        {
+            return count_;
+        }
+
+    private:
+        Buffer buffers_[iovec_state::max_buffers];
+        std::size_t count_ = 0;
+    };
+
+    // Issues async_read_some / async_write_some on the stream until the
+    // whole sequence has been transferred, then calls
+    // handler(std::error_code, std::size_t) with the total. The handler's
+    // allocator and cancellation slot are used for every step.
+    template <typename Stream, typename Buffers, typename Buffer, typename Handler>
+    class transfer_all_op
+    {
+    public:
+        using allocator_type = typename associated_allocator<Handler, recycling_allocator<void>>::type;
+        using cancellation_slot_type = typename associated_cancellation_slot<Handler>::type;
+
+        template <typename H>
+        transfer_all_op(Stream &stream, const Buffers &buffers, H &&handler)
+            : stream_(stream), buffers_(buffers), total_(0), handler_(std::forward<H>(handler))
+        {
+        }
+
+        allocator_type get_allocator() const noexcept
+        {
+            return get_associated_allocator(handler_, stream_.get_uring().get_allocator());
+        }
+
+        cancellation_slot_type get_cancellation_slot() const noexcept
+        {
+            return get_associated_cancellation_slot(handler_);
+        }
+
+        void start()
+        {
+            // Nothing to transfer: complete through the ring rather than
+            // from inside the initiating function.
+            if (consuming_buffers<Buffer>(buffers_, 0).empty())
+            {
+                post(stream_.get_uring(), [op = std::move(*this)](std::error_code) mutable
+                     { op.handler_(std::error_code(), 0); });
+                return;
+            }
+
+            step(std::error_code(), 0);
+        }
+
+        void operator()(std::error_code ec, std::size_t n)
+        {
+            if (!ec && n == 0 && std::is_same<Buffer, mutable_buffer>::value)
+                ec = misc_errc::eof;
+            step(ec, n);
+        }
+
+    private:
+        void step(std::error_code ec, std::size_t n)
+        {
+            total_ += n;
+            consuming_buffers<Buffer> rest(buffers_, total_);
+            if (ec || rest.empty())
+            {
+                handler_(ec, total_);
+                return;
+            }
+
+            if (rest.size() == 1)
+                transfer(*rest.begin());
+            else
+                transfer(rest);
+        }
+
+        template <typename B>
+        void transfer(const B &buffers)
+        {
+            if constexpr (std::is_same<Buffer, mutable_buffer>::value)
+                stream_.async_read_some(buffers, std::move(*this));
+            else
+                stream_.async_write_some(buffers, std::move(*this));
+        }
+
+        Stream &stream_;
+        Buffers buffers_;
+        std::size_t total_;
+        Handler handler_;
+    };
+
+    // Reads until the buffer sequence is full. A stream that ends first
+    // completes with misc_errc::eof and the number of bytes read. The
+    // sequence is copied; the memory it refers to must stay valid.
+    template <typename Stream, typename MutableBufferSequence, typename Handler>
+    typename std::enable_if<is_mutable_buffer_sequence<MutableBufferSequence>::value,
+                            async_return_t<Handler, void(std::error_code, std::size_t)>>::type
+    async_read(Stream &stream, const MutableBufferSequence &buffers, Handler &&handler)
+    {
+        return async_initiate<void(std::error_code, std::size_t)>(
+            [&stream, buffers](auto &&handler)
+            {
+                using H = typename std::decay<decltype(handler)>::type;
+                transfer_all_op<Stream, MutableBufferSequence, mutable_buffer, H>(
+                    stream, buffers, std::forward<decltype(handler)>(handler))
+                    .start();
+            },
+            std::forward<Handler>(handler));
+    }
+
+    // Writes the whole buffer sequence.
+    template <typename Stream, typename ConstBufferSequence, typename Handler>
+    typename std::enable_if<is_const_buffer_sequence<ConstBufferSequence>::value,
+                            async_return_t<Handler, void(std::error_code, std::size_t)>>::type
+    async_write(Stream &stream, const ConstBufferSequence &buffers, Handler &&handler)
+    {
+        return async_initiate<void(std::error_code, std::size_t)>(
+            [&stream, buffers](auto &&handler)
+            {
+                using H = typename std::decay<decltype(handler)>::type;
+                transfer_all_op<Stream, ConstBufferSequence, const_buffer, H>(
+                    stream, buffers, std::forward<decltype(handler)>(handler))
+                    .start();
+            },
+            std::forward<Handler>(handler));
+    }
+
+}
+
+#endif /* IORING_READ_WRITE_HPP */
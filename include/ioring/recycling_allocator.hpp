@@ -0,0 +1,70 @@
+#ifndef IORING_RECYCLING_ALLOCATOR_HPP
+#define IORING_RECYCLING_ALLOCATOR_HPP
+
+#include <ioring/operation_pool.hpp>
+
+#include <cstddef>
+
+namespace ioring
+{
+
+    template <typename T>
+    class recycling_allocator
+    {
+    public:
+        using value_type = T;
+
+        template <typename U>
+        struct rebind
+        {
+            using other = recycling_allocator<U>;
+        };
+
+        explicit recycling_allocator(operation_pool &pool) noexcept
+            : pool_(&pool)
+        {
+        }
+
+        template <typename U>
+        recycling_allocator(const recycling_allocator<U> &other) noexcept
+            : pool_(other.pool_)
+        {
+        }
+
+        T *allocate(std::size_t n)
+        {
+            return static_cast<T *>(pool_->allocate(sizeof(T) * n, alignof(T)));
+        }
+
+        void deallocate(T *p, std::size_t n) noexcept
+        {
+            pool_->deallocate(p, sizeof(T) * n, alignof(T));
+        }
+
+        operation_pool &pool() const noexcept
+        {
+            return *pool_;
+        }
+
+        template <typename U>
+        bool operator==(const recycling_allocator<U> &other) const noexcept
+        {
+            return pool_ == other.pool_;
+        }
+
+        template <typename U>
+        bool operator!=(const recycling_allocator<U> &other) const noexcept
+        {
+            return pool_ != other.pool_;
+        }
+
+    private:
+        template <typename U>
+        friend class recycling_allocator;
+
+        operation_pool *pool_;
+    };
+
+}
+
+#endif /* IORING_RECYCLING_ALLOCATOR_HPP */
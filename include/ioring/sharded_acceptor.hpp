@@ -0,0 +1,67 @@
+#ifndef IORING_SHARDED_ACCEPTOR_HPP
+#define IORING_SHARDED_ACCEPTOR_HPP
+
+#include <ioring/acceptor.hpp>
+#include <ioring/uring_pool.hpp>
+
+#include <memory>
+#include <vector>
+
+namespace ioring
+{
+
+    // One SO_REUSEPORT listener per ring of a uring_pool. The kernel spreads
+    // incoming connections across the listeners, and every connection is
+    // then served by the ring, and therefore the core, that accepted it.
+    class sharded_acceptor
+    {
+    public:
+        template <typename Protocol, typename Endpoint>
+        sharded_acceptor(uring_pool &pool, const Protocol &protocol, const Endpoint &endpoint, int backlog)
+        {
+            acceptors_.reserve(pool.size());
+            for (std::size_t i = 0; i < pool.size(); ++i)
+            {
+                std::unique_ptr<acceptor> acc(new acceptor(pool.get(i)));
+                acc->open(protocol);
+                acc->set_option(acceptor::reuse_address(true));
+                acc->set_option(acceptor::reuse_port(true));
+                acc->bind(endpoint);
+                acc->listen(backlog);
+                acceptors_.push_back(std::move(acc));
+            }
+        }
+
+        std::size_t size() const noexcept
+        {
+            return acceptors_.size();
+        }
+
+        acceptor &operator[](std::size_t index) const noexcept
+        {
+            return *acceptors_[index];
+        }
+
+        // Arms a multishot accept on every shard. Each shard gets its own copy
+        // of the handler, invoked on that shard's thread as
+        // handler(std::error_code, int fd, uring &). Must be called before
+        // uring_pool::run().
+        template <typename Handler>
+        void async_accept_multishot(const Handler &handler)
+        {
+            for (auto &acc : acceptors_)
+            {
+                uring &ring = acc->get_uring();
+                acc->async_accept_multishot(
+                    [h = handler, &ring](std::error_code ec, int fd) mutable
+                    { h(ec, fd, ring); });
+            }
+        }
+
+    private:
+        std::vector<std::unique_ptr<acceptor>> acceptors_;
+    };
+
+}
+
+#endif /* IORING_SHARDED_ACCEPTOR_HPP */
@@ -96,6 +96,51 @@ namespace ioring
             int value_;
         };
 
+        struct reuse_port
+        {
+            explicit reuse_port(bool v) noexcept : value_(v)
+            {
+            }
+
+            explicit operator bool() const noexcept
+            {
+                return value_;
+            }
+
+            static constexpr int layer()
+            {
+                return SOL_SOCKET;
+            }
+
+            static constexpr int name()
+            {
+                return SO_REUSEPORT;
+            }
+
+            void *value() noexcept
+            {
+                return &value_;
+            }
+
+            const void *value() const noexcept
+            {
+                return &value_;
+            }
+
+            socklen_t length() const noexcept
+            {
+                return sizeof(value_);
+            }
+
+            void length(socklen_t len)
+            {
+                (void)len;
+                assert(len == sizeof(value_));
+            }
+
+            int value_;
+        };
+
         template <typename SettableOption>
         void set_option(const SettableOption &option)
         {
@@ -125,18 +170,41 @@ namespace ioring
         };
 
         template <typename Handler>
-        void async_shutdown(shutdown_method method, Handler &&handler)
+        async_return_t<Handler, void(std::error_code)>
+        async_shutdown(shutdown_method method, Handler &&handler)
         {
-            get_uring().submit(
-                [&](io_uring_sqe *sqe)
+            return async_initiate<void(std::error_code)>(
+                [this, method](auto &&handler)
                 {
+                    using H = decltype(handler);
+                    get_uring().submit(
+                        [&](io_uring_sqe *sqe)
+                        {
+                            memset(sqe, 0, sizeof(*sqe));
+                            sqe->opcode = IORING_OP_SHUTDOWN;
+                            this->prepare_fd(sqe);
+                            sqe->len = static_cast<__u32>(method);
+                            cancellation_slot slot = get_associated_cancellation_slot(handler);
+                            sqe->user_data = wrapped_operation<
+                                post_op<typename std::decay<H>::type>>::create(
+                                    get_associated_allocator(handler, get_uring().get_allocator()),
+                                    get_uring(), std::forward<H>(handler));
+                            slot.assign(get_uring(), sqe->user_data);
+                        });
+                },
+                std::forward<Handler>(handler));
+        }
+
+        // Like async_shutdown, without a completion or an allocation; a
+        // failure reaches the ring's error sink.
+        void async_shutdown(shutdown_method method, detached_t)
+        {
+            get_uring().submit_detached(detached_op::shutdown, native_handle(), [&](io_uring_sqe *sqe)
+                                        {
                     memset(sqe, 0, sizeof(*sqe));
                     sqe->opcode = IORING_OP_SHUTDOWN;
-                    sqe->fd = this->native_handle();
-                    sqe->len = static_cast<__u32>(method);
-                    sqe->user_data = wrapped_operation<
-                        post_op<typename std::decay<Handler>::type>>::create(get_uring(), std::forward<Handler>(handler));
-                });
+                    this->prepare_fd(sqe);
+                    sqe->len = static_cast<__u32>(method); });
         }
     };
 
@@ -0,0 +1,288 @@
+#ifndef IORING_SQE_CHAIN_HPP
+#define IORING_SQE_CHAIN_HPP
+
+#include <ioring/uring.hpp>
+#include <ioring/buffers.hpp>
+#include <ioring/async_result.hpp>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+namespace ioring
+{
+
+    // Results of the links of a chain, in submission order. A link that
+    // fails breaks the chain: the links after it complete with -ECANCELED.
+    // Reads and writes also break it on a short transfer.
+    class chain_results
+    {
+    public:
+        static constexpr unsigned max_links = 8;
+
+        unsigned size() const noexcept
+        {
+            return size_;
+        }
+
+        // Raw CQE result of link `i`: a byte count or a negated errno.
+        int operator[](unsigned i) const noexcept
+        {
+            return res_[i];
+        }
+
+        std::error_code error(unsigned i) const noexcept
+        {
+            return res_[i] < 0 ? std::error_code(-res_[i], std::system_category()) : std::error_code();
+        }
+
+        // Error of the first link that did not succeed. A chain broken by
+        // a short transfer reports std::errc::operation_canceled.
+        std::error_code error() const noexcept
+        {
+            for (unsigned i = 0; i < size_; ++i)
+                if (res_[i] < 0)
+                    return error(i);
+            return std::error_code();
+        }
+
+    private:
+        template <typename Handler, typename Allocator>
+        friend struct chain_operation;
+
+        unsigned size_ = 0;
+        int res_[max_links] = {};
+    };
+
+    // One allocation per chain; every link gets its own user_data so that
+    // results are recorded per link, and the handler runs once, after the
+    // last CQE of the chain, as handler(std::error_code, chain_results).
+    template <typename Handler, typename Allocator>
+    struct chain_operation
+    {
+        using allocator_type = typename std::allocator_traits<Allocator>::template rebind_alloc<chain_operation>;
+
+        struct link : operation
+        {
+            chain_operation *owner;
+            unsigned index;
+        };
+
+        template <typename H>
+        chain_operation(const Allocator &alloc, unsigned size, H &&h)
+            : remaining(size), alloc(alloc), handler(std::forward<H>(h))
+        {
+            results.size_ = size;
+            for (unsigned i = 0; i < size; ++i)
+            {
+                links[i].complete = link_complete;
+                links[i].owner = this;
+                links[i].index = i;
+            }
+        }
+
+        static void link_complete(io_uring_cqe *cqe)
+        {
+            link *l = static_cast<link *>(reinterpret_cast<operation *>(cqe->user_data));
+            chain_operation *self = l->owner;
+            self->results.res_[l->index] = cqe->res;
+            if (--self->remaining)
+                return;
+
+            allocator_type a(self->alloc);
+            Handler h(std::move(self->handler));
+            chain_results r = self->results;
+            self->~chain_operation();
+            a.deallocate(self, 1);
+            h(r.error(), r);
+        }
+
+        link links[chain_results::max_links];
+        unsigned remaining;
+        chain_results results;
+        Allocator alloc;
+        Handler handler;
+    };
+
+    // Builds a chain of SQEs linked with IOSQE_IO_LINK and submits them in
+    // one go, e.g. ring.chain().write(sock, header).write(sock, body).
+    // submit(handler). Buffers must stay valid until the handler runs.
+    class sqe_chain
+    {
+    public:
+        static constexpr unsigned max_links = chain_results::max_links;
+
+        explicit sqe_chain(uring &ring) noexcept
+            : ring_(ring), size_(0), hard_(0)
+        {
+        }
+
+        template <typename Descriptor>
+        sqe_chain &read(const Descriptor &d, mutable_buffer buffer)
+        {
+            io_uring_sqe &sqe = next(IORING_OP_READ);
+            d.prepare_fd(&sqe);
+            sqe.addr = reinterpret_cast<__u64>(buffer.data());
+            sqe.len = buffer.size();
+            return *this;
+        }
+
+        template <typename Descriptor>
+        sqe_chain &read(const Descriptor &d, mutable_registered_buffer buffer)
+        {
+            io_uring_sqe &sqe = next(IORING_OP_READ_FIXED);
+            d.prepare_fd(&sqe);
+            sqe.addr = reinterpret_cast<__u64>(buffer.data());
+            sqe.len = buffer.size();
+            sqe.buf_index = buffer.buffer_index();
+            return *this;
+        }
+
+        template <typename Descriptor>
+        sqe_chain &write(const Descriptor &d, const_buffer buffer)
+        {
+            io_uring_sqe &sqe = next(IORING_OP_WRITE);
+            d.prepare_fd(&sqe);
+            sqe.addr = reinterpret_cast<__u64>(buffer.data());
+            sqe.len = buffer.size();
+            return *this;
+        }
+
+        template <typename Descriptor>
+        sqe_chain &write(const Descriptor &d, const_registered_buffer buffer)
+        {
+            io_uring_sqe &sqe = next(IORING_OP_WRITE_FIXED);
+            d.prepare_fd(&sqe);
+            sqe.addr = reinterpret_cast<__u64>(buffer.data());
+            sqe.len = buffer.size();
+            sqe.buf_index = buffer.buffer_index();
+            return *this;
+        }
+
+        // `how` is one of SHUT_RD, SHUT_WR and SHUT_RDWR.
+        template <typename Socket>
+        sqe_chain &shutdown(const Socket &s, int how)
+        {
+            io_uring_sqe &sqe = next(IORING_OP_SHUTDOWN);
+            s.prepare_fd(&sqe);
+            sqe.len = static_cast<__u32>(how);
+            return *this;
+        }
+
+        // Moves `size` bytes from `in` to `out`; one of them must be a pipe.
+        template <typename In, typename Out>
+        sqe_chain &splice(const In &in, const Out &out, std::size_t size)
+        {
+            prepare_splice(&next(IORING_OP_SPLICE), IORING_OP_SPLICE, in, out, size);
+            return *this;
+        }
+
+        template <typename In, typename Out>
+        sqe_chain &tee(const In &in, const Out &out, std::size_t size)
+        {
+            prepare_splice(&next(IORING_OP_TEE), IORING_OP_TEE, in, out, size);
+            return *this;
+        }
+
+        sqe_chain &nop()
+        {
+            next(IORING_OP_NOP);
+            return *this;
+        }
+
+        // Appends an SQE filled in by prepare(io_uring_sqe *); flags other
+        // than the link flags are kept, user_data is overwritten.
+        template <typename Prepare>
+        sqe_chain &add(Prepare &&prepare)
+        {
+            prepare(&next(IORING_OP_NOP));
+            return *this;
+        }
+
+        // Makes the previous link hard: the chain goes on even if it fails.
+        sqe_chain &hardlink() noexcept
+        {
+            if (size_ > 0)
+                hard_ |= 1u << (size_ - 1);
+            return *this;
+        }
+
+        unsigned size() const noexcept
+        {
+            return size_;
+        }
+
+        template <typename Handler>
+        async_return_t<Handler, void(std::error_code, chain_results)>
+        submit(Handler &&handler)
+        {
+            return async_initiate<void(std::error_code, chain_results)>(
+                [this](auto &&handler)
+                {
+                    using H = decltype(handler);
+                    using allocator_type = typename associated_allocator<typename std::decay<H>::type,
+                                                                         recycling_allocator<void>>::type;
+                    using op_type = chain_operation<typename std::decay<H>::type, allocator_type>;
+
+                    if (size_ == 0)
+                        throw std::length_error("sqe_chain::submit: empty chain");
+
+                    submission_batch batch(ring_);
+                    ring_.reserve(size_);
+
+                    typename op_type::allocator_type a(get_associated_allocator(handler, ring_.get_allocator()));
+                    op_type *op = a.allocate(1);
+                    try
+                    {
+                        ::new (static_cast<void *>(op)) op_type(
+                            get_associated_allocator(handler, ring_.get_allocator()), size_, std::forward<H>(handler));
+                    }
+                    catch (...)
+                    {
+                        a.deallocate(op, 1);
+                        throw;
+                    }
+
+                    for (unsigned i = 0; i < size_; ++i)
+                    {
+                        ring_.submit([&](io_uring_sqe *sqe)
+                                     {
+                                *sqe = sqes_[i];
+                                sqe->flags &= ~(IOSQE_IO_LINK | IOSQE_IO_HARDLINK);
+                                if (i + 1 < size_)
+                                    sqe->flags |= (hard_ & (1u << i)) ? IOSQE_IO_HARDLINK : IOSQE_IO_LINK;
+                                sqe->user_data = reinterpret_cast<__u64>(static_cast<operation *>(&op->links[i])); });
+                    }
+                    size_ = 0;
+                    hard_ = 0;
+                },
+                std::forward<Handler>(handler));
+        }
+
+    private:
+        io_uring_sqe &next(__u8 opcode)
+        {
+            if (size_ == max_links)
+                throw std::length_error("sqe_chain: too many links");
+
+            io_uring_sqe &sqe = sqes_[size_++];
+            memset(&sqe, 0, sizeof(sqe));
+            sqe.opcode = opcode;
+            return sqe;
+        }
+
+        uring &ring_;
+        unsigned size_;
+        unsigned hard_;
+        io_uring_sqe sqes_[max_links];
+    };
+
+    inline sqe_chain uring::chain() noexcept
+    {
+        return sqe_chain(*this);
+    }
+
+}
+
+#endif /* IORING_SQE_CHAIN_HPP */
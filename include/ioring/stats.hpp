@@ -0,0 +1,177 @@
+#ifndef IORING_STATS_HPP
+#define IORING_STATS_HPP
+
+#include <ioring/config.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+#include <linux/io_uring.h>
+
+namespace ioring
+{
+
+    // Log-linear histogram in the style of HdrHistogram: every power of two
+    // is split into 8 linear sub-buckets, so a recorded value is off by at
+    // most 1/8 of itself. Covers the full 64-bit range in 496 counters.
+    class latency_histogram
+    {
+    public:
+        static constexpr unsigned sub_bucket_bits = 4;
+        static constexpr unsigned half_sub_buckets = 1u << (sub_bucket_bits - 1);
+        static constexpr unsigned bucket_count = (64 - sub_bucket_bits + 1) * half_sub_buckets + half_sub_buckets;
+
+        void record(std::uint64_t value) noexcept
+        {
+            ++counts_[index_of(value)];
+            ++count_;
+            sum_ += value;
+            if (value > max_)
+                max_ = value;
+            if (count_ == 1 || value < min_)
+                min_ = value;
+        }
+
+        std::uint64_t count() const noexcept
+        {
+            return count_;
+        }
+
+        std::uint64_t min() const noexcept
+        {
+            return min_;
+        }
+
+        std::uint64_t max() const noexcept
+        {
+            return max_;
+        }
+
+        double mean() const noexcept
+        {
+            return count_ ? static_cast<double>(sum_) / static_cast<double>(count_) : 0.0;
+        }
+
+        // Upper bound of the bucket holding the given percentile (0-100),
+        // clamped to the largest recorded value.
+        std::uint64_t percentile(double p) const noexcept
+        {
+            if (count_ == 0)
+                return 0;
+
+            std::uint64_t rank = static_cast<std::uint64_t>(p / 100.0 * static_cast<double>(count_) + 0.5);
+            if (rank < 1)
+                rank = 1;
+
+            std::uint64_t seen = 0;
+            for (unsigned i = 0; i < bucket_count; ++i)
+            {
+                seen += counts_[i];
+                if (seen >= rank)
+                    return upper_bound(i) < max_ ? upper_bound(i) : max_;
+            }
+            return max_;
+        }
+
+        // Calls f(lowest, highest, count) for every non-empty bucket.
+        template <typename F>
+        void for_each_bucket(F &&f) const
+        {
+            for (unsigned i = 0; i < bucket_count; ++i)
+                if (counts_[i])
+                    f(lower_bound(i), upper_bound(i), counts_[i]);
+        }
+
+        void merge(const latency_histogram &other) noexcept
+        {
+            if (other.count_ == 0)
+                return;
+            for (unsigned i = 0; i < bucket_count; ++i)
+                counts_[i] += other.counts_[i];
+            if (count_ == 0 || other.min_ < min_)
+                min_ = other.min_;
+            if (other.max_ > max_)
+                max_ = other.max_;
+            count_ += other.count_;
+            sum_ += other.sum_;
+        }
+
+        static unsigned index_of(std::uint64_t value) noexcept
+        {
+            unsigned msb = value ? 63 - static_cast<unsigned>(__builtin_clzll(value)) : 0;
+            unsigned shift = msb >= sub_bucket_bits ? msb - sub_bucket_bits + 1 : 0;
+            return shift * half_sub_buckets + static_cast<unsigned>(value >> shift);
+        }
+
+        static std::uint64_t lower_bound(unsigned index) noexcept
+        {
+            if (index < 2 * half_sub_buckets)
+                return index;
+            unsigned shift = index / half_sub_buckets - 1;
+            return static_cast<std::uint64_t>(index - shift * half_sub_buckets) << shift;
+        }
+
+        static std::uint64_t upper_bound(unsigned index) noexcept
+        {
+            if (index < 2 * half_sub_buckets)
+                return index;
+            unsigned shift = index / half_sub_buckets - 1;
+            return lower_bound(index) + ((std::uint64_t(1) << shift) - 1);
+        }
+
+    private:
+        std::uint64_t counts_[bucket_count] = {};
+        std::uint64_t count_ = 0;
+        std::uint64_t sum_ = 0;
+        std::uint64_t min_ = 0;
+        std::uint64_t max_ = 0;
+    };
+
+    // Counters a ring keeps when built with IORING_ENABLE_STATS. Updated
+    // on the ring's thread only; uring::stats() returns a copy of them.
+    struct ring_stats
+    {
+        static constexpr unsigned opcode_count = IORING_OP_LAST;
+
+        // Errors are counted by errno; larger values share the last slot.
+        static constexpr unsigned errno_count = 160;
+
+        // SQEs submitted and CQEs reaped per opcode. A multishot request
+        // adds one submission and several completions; failed counts CQEs
+        // with a negative result, which includes the -ETIME of timeouts.
+        std::uint64_t submitted[opcode_count] = {};
+        std::uint64_t completed[opcode_count] = {};
+        std::uint64_t failed[opcode_count] = {};
+
+        std::uint64_t errors[errno_count] = {};
+
+        // Operations completed through uring::enqueue() without a CQE.
+        std::uint64_t posted = 0;
+
+        // Times submit() found the SQ full and had to wait for the kernel.
+        std::uint64_t sq_full_stalls = 0;
+
+        // io_uring_enter calls, those that only woke the SQPOLL thread, and
+        // those that waited for at least one completion.
+        std::uint64_t enter_calls = 0;
+        std::uint64_t sqpoll_wakeups = 0;
+        std::uint64_t blocking_waits = 0;
+
+        // CQEs reaped per reap of the completion queue.
+        latency_histogram cq_batch;
+
+        // Nanoseconds from publishing an SQE to reaping its first CQE.
+        latency_histogram latency[opcode_count];
+
+        latency_histogram total_latency() const noexcept
+        {
+            latency_histogram all;
+            for (const latency_histogram &h : latency)
+                all.merge(h);
+            return all;
+        }
+    };
+
+}
+
+#endif /* IORING_STATS_HPP */
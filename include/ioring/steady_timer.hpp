@@ -0,0 +1,131 @@
+#ifndef IORING_STEADY_TIMER_HPP
+#define IORING_STEADY_TIMER_HPP
+
+#include <ioring/uring.hpp>
+#include <ioring/post.hpp>
+
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+
+namespace ioring
+{
+
+    // Timer on the ring's timer wheel. Waits complete as
+    // handler(std::error_code) on the ring's thread, with
+    // std::errc::operation_canceled if the timer was cancelled, reset or
+    // destroyed first. A timer must only be used from the ring's thread.
+    class steady_timer
+    {
+    public:
+        using clock_type = std::chrono::steady_clock;
+        using duration = clock_type::duration;
+        using time_point = clock_type::time_point;
+
+        explicit steady_timer(uring &ring) noexcept
+            : ring_(ring), expiry_()
+        {
+        }
+
+        steady_timer(uring &ring, duration d)
+            : ring_(ring), expiry_(clock_type::now() + d)
+        {
+        }
+
+        steady_timer(const steady_timer &) = delete;
+        steady_timer &operator=(const steady_timer &) = delete;
+
+        ~steady_timer()
+        {
+            try
+            {
+                cancel();
+            }
+            catch (...)
+            {
+            }
+        }
+
+        time_point expiry() const noexcept
+        {
+            return expiry_;
+        }
+
+        // Both setters cancel pending waits and return how many there were.
+        std::size_t expires_at(time_point t)
+        {
+            std::size_t n = cancel();
+            expiry_ = t;
+            return n;
+        }
+
+        std::size_t expires_after(duration d)
+        {
+            return expires_at(clock_type::now() + d);
+        }
+
+        std::size_t cancel()
+        {
+            if (!entry_.waiters)
+                return 0;
+
+            ring_.cancel_timer(entry_);
+
+            operation *fifo = nullptr;
+            for (operation *op = entry_.waiters; op;)
+            {
+                operation *next = op->next;
+                op->next = fifo;
+                fifo = op;
+                op = next;
+            }
+            entry_.waiters = nullptr;
+
+            std::size_t n = 0;
+            while (fifo)
+            {
+                operation *next = fifo->next;
+                fifo->result = -ECANCELED;
+                ring_.enqueue(fifo);
+                fifo = next;
+                ++n;
+            }
+            return n;
+        }
+
+        template <typename Handler>
+        async_return_t<Handler, void(std::error_code)>
+        async_wait(Handler &&handler)
+        {
+            return async_initiate<void(std::error_code)>(
+                [this](auto &&handler)
+                {
+                    using H = decltype(handler);
+                    __u64 op = wrapped_operation<post_op<H>>::create(
+                        get_associated_allocator(handler, ring_.get_allocator()),
+                        ring_, std::forward<H>(handler));
+
+                    operation *wait = static_cast<operation *>(reinterpret_cast<void *>(op));
+                    wait->next = entry_.waiters;
+                    entry_.waiters = wait;
+
+                    if (!entry_.linked)
+                        ring_.schedule_timer(entry_, expiry_);
+                },
+                std::forward<Handler>(handler));
+        }
+
+        uring &get_uring() const noexcept
+        {
+            return ring_;
+        }
+
+    private:
+        uring &ring_;
+        time_point expiry_;
+        timer_wheel::entry entry_;
+    };
+
+}
+
+#endif /* IORING_STEADY_TIMER_HPP */
@@ -3,6 +3,7 @@
 
 #include <ioring/descriptor.hpp>
 #include <ioring/buffers.hpp>
+#include <ioring/vectored.hpp>
 
 namespace ioring
 {
@@ -17,82 +18,221 @@ namespace ioring
         }
 
         template <typename Handler>
-        void async_read_some(mutable_buffer buffer, Handler &&handler);
+        async_return_t<Handler, void(std::error_code, std::size_t)> async_read_some(mutable_buffer buffer, Handler &&handler);
+
+        // Overloads taking a timeout link an IORING_OP_LINK_TIMEOUT to the
+        // operation, which then fails with std::errc::timed_out if it has not
+        // completed in time.
+        template <typename Rep, typename Period, typename Handler>
+        async_return_t<Handler, void(std::error_code, std::size_t)> async_read_some(mutable_buffer buffer, std::chrono::duration<Rep, Period> timeout, Handler &&handler);
+
+        template <typename Handler>
+        async_return_t<Handler, void(std::error_code, std::size_t)> async_read_some(mutable_registered_buffer buffer, Handler &&handler);
 
         template <typename Handler>
-        void async_write_some(const_buffer buffer, Handler &&handler);
+        async_return_t<Handler, void(std::error_code, std::size_t)> async_write_some(const_buffer buffer, Handler &&handler);
+
+        template <typename Rep, typename Period, typename Handler>
+        async_return_t<Handler, void(std::error_code, std::size_t)> async_write_some(const_buffer buffer, std::chrono::duration<Rep, Period> timeout, Handler &&handler);
+
+        template <typename Handler>
+        async_return_t<Handler, void(std::error_code, std::size_t)> async_write_some(const_registered_buffer buffer, Handler &&handler);
+
+        template <typename Handler>
+        async_return_t<Handler, void(std::error_code, std::size_t)> async_write_some(mutable_registered_buffer buffer, Handler &&handler)
+        {
+            return async_write_some(const_registered_buffer(buffer), std::forward<Handler>(handler));
+        }
+
+        // Buffer sequences go out as a single IORING_OP_READV / IORING_OP_WRITEV;
+        // at most iovec_state::max_buffers buffers are transferred at a time.
+        template <typename MutableBufferSequence, typename Handler>
+        mutable_sequence_return_t<MutableBufferSequence, Handler> async_read_some(const MutableBufferSequence &buffers, Handler &&handler);
+
+        template <typename ConstBufferSequence, typename Handler>
+        const_sequence_return_t<ConstBufferSequence, Handler> async_write_some(const ConstBufferSequence &buffers, Handler &&handler);
     };
 
     template <typename Handler>
-    void stream_descriptor::async_read_some(mutable_buffer buffer, Handler &&handler)
+    async_return_t<Handler, void(std::error_code, std::size_t)>
+    stream_descriptor::async_read_some(mutable_buffer buffer, Handler &&handler)
     {
-        struct read_op
-        {
-            explicit read_op(Handler &&h)
-                : handler_(std::forward<Handler>(h))
+        return async_initiate<void(std::error_code, std::size_t)>(
+            [this, buffer](auto &&handler)
+            {
+                using H = decltype(handler);
+                get_uring().submit([&](io_uring_sqe *sqe)
+                                   {
+                        memset(sqe, 0, sizeof(*sqe));
+                        sqe->opcode = IORING_OP_READ;
+                        this->prepare_fd(sqe);
+                        sqe->addr = reinterpret_cast<__u64>(buffer.data());
+                        sqe->len = buffer.size();
+                        cancellation_slot slot = get_associated_cancellation_slot(handler);
+                        sqe->user_data = wrapped_operation<transfer_op<H>>::create(
+                            get_associated_allocator(handler, get_uring().get_allocator()),
+                            std::forward<H>(handler));
+                        slot.assign(get_uring(), sqe->user_data); });
+            },
+            std::forward<Handler>(handler));
+    }
+
+    template <typename Rep, typename Period, typename Handler>
+    async_return_t<Handler, void(std::error_code, std::size_t)>
+    stream_descriptor::async_read_some(mutable_buffer buffer, std::chrono::duration<Rep, Period> timeout, Handler &&handler)
+    {
+        return async_initiate<void(std::error_code, std::size_t)>(
+            [this, buffer, timeout](auto &&handler)
+            {
+                using H = decltype(handler);
+                submit_with_deadline<transfer_op<H>>(
+                    get_uring(), std::chrono::ceil<std::chrono::nanoseconds>(timeout), [&](io_uring_sqe *sqe)
+                    {
+                        memset(sqe, 0, sizeof(*sqe));
+                        sqe->opcode = IORING_OP_READ;
+                        this->prepare_fd(sqe);
+                        sqe->addr = reinterpret_cast<__u64>(buffer.data());
+                        sqe->len = buffer.size(); },
+                    std::forward<H>(handler));
+            },
+            std::forward<Handler>(handler));
+    }
+
+    template <typename Rep, typename Period, typename Handler>
+    async_return_t<Handler, void(std::error_code, std::size_t)>
+    stream_descriptor::async_write_some(const_buffer buffer, std::chrono::duration<Rep, Period> timeout, Handler &&handler)
+    {
+        return async_initiate<void(std::error_code, std::size_t)>(
+            [this, buffer, timeout](auto &&handler)
             {
-            }
+                using H = decltype(handler);
+                submit_with_deadline<transfer_op<H>>(
+                    get_uring(), std::chrono::ceil<std::chrono::nanoseconds>(timeout), [&](io_uring_sqe *sqe)
+                    {
+                        memset(sqe, 0, sizeof(*sqe));
+                        sqe->opcode = IORING_OP_WRITE;
+                        this->prepare_fd(sqe);
+                        sqe->addr = reinterpret_cast<__u64>(buffer.data());
+                        sqe->len = buffer.size(); },
+                    std::forward<H>(handler));
+            },
+            std::forward<Handler>(handler));
+    }
 
-            void operator()(io_uring_cqe *cqe)
+    template <typename Handler>
+    async_return_t<Handler, void(std::error_code, std::size_t)>
+    stream_descriptor::async_read_some(mutable_registered_buffer buffer, Handler &&handler)
+    {
+        return async_initiate<void(std::error_code, std::size_t)>(
+            [this, buffer](auto &&handler)
             {
-                if (cqe->res < 0)
-                {
-                    handler_(std::error_code(-cqe->res, std::system_category()),
-                             0);
-                }
-                else
-                {
-                    handler_(std::error_code(), cqe->res);
-                }
-            }
-
-            typename std::decay<Handler>::type handler_;
-        };
-
-        get_uring().submit([&](io_uring_sqe *sqe)
-                           {
-                memset(sqe, 0, sizeof(*sqe));
-                sqe->opcode = IORING_OP_READ;
-                sqe->fd = this->native_handle();
-                sqe->addr = reinterpret_cast<__u64>(buffer.data());
-                sqe->len = buffer.size();
-                sqe->user_data = wrapped_operation<read_op>::create(std::forward<Handler>(handler)); });
+                using H = decltype(handler);
+                get_uring().submit([&](io_uring_sqe *sqe)
+                                   {
+                        memset(sqe, 0, sizeof(*sqe));
+                        sqe->opcode = IORING_OP_READ_FIXED;
+                        this->prepare_fd(sqe);
+                        sqe->addr = reinterpret_cast<__u64>(buffer.data());
+                        sqe->len = buffer.size();
+                        sqe->buf_index = buffer.buffer_index();
+                        cancellation_slot slot = get_associated_cancellation_slot(handler);
+                        sqe->user_data = wrapped_operation<transfer_op<H>>::create(
+                            get_associated_allocator(handler, get_uring().get_allocator()),
+                            std::forward<H>(handler));
+                        slot.assign(get_uring(), sqe->user_data); });
+            },
+            std::forward<Handler>(handler));
     }
 
     template <typename Handler>
-    void stream_descriptor::async_write_some(const_buffer buffer, Handler &&handler)
+    async_return_t<Handler, void(std::error_code, std::size_t)>
+    stream_descriptor::async_write_some(const_buffer buffer, Handler &&handler)
     {
-        struct write_op
-        {
-            explicit write_op(Handler &&h)
-                : handler_(std::forward<Handler>(h))
+        return async_initiate<void(std::error_code, std::size_t)>(
+            [this, buffer](auto &&handler)
+            {
+                using H = decltype(handler);
+                get_uring().submit([&](io_uring_sqe *sqe)
+                                   {
+                        memset(sqe, 0, sizeof(*sqe));
+                        sqe->opcode = IORING_OP_WRITE;
+                        this->prepare_fd(sqe);
+                        sqe->addr = reinterpret_cast<__u64>(buffer.data());
+                        sqe->len = buffer.size();
+                        cancellation_slot slot = get_associated_cancellation_slot(handler);
+                        sqe->user_data = wrapped_operation<transfer_op<H>>::create(
+                            get_associated_allocator(handler, get_uring().get_allocator()),
+                            std::forward<H>(handler));
+                        slot.assign(get_uring(), sqe->user_data); });
+            },
+            std::forward<Handler>(handler));
+    }
+
+    template <typename Handler>
+    async_return_t<Handler, void(std::error_code, std::size_t)>
+    stream_descriptor::async_write_some(const_registered_buffer buffer, Handler &&handler)
+    {
+        return async_initiate<void(std::error_code, std::size_t)>(
+            [this, buffer](auto &&handler)
             {
-            }
+                using H = decltype(handler);
+                get_uring().submit([&](io_uring_sqe *sqe)
+                                   {
+                        memset(sqe, 0, sizeof(*sqe));
+                        sqe->opcode = IORING_OP_WRITE_FIXED;
+                        this->prepare_fd(sqe);
+                        sqe->addr = reinterpret_cast<__u64>(buffer.data());
+                        sqe->len = buffer.size();
+                        sqe->buf_index = buffer.buffer_index();
+                        cancellation_slot slot = get_associated_cancellation_slot(handler);
+                        sqe->user_data = wrapped_operation<transfer_op<H>>::create(
+                            get_associated_allocator(handler, get_uring().get_allocator()),
+                            std::forward<H>(handler));
+                        slot.assign(get_uring(), sqe->user_data); });
+            },
+            std::forward<Handler>(handler));
+    }
 
-            void operator()(io_uring_cqe *cqe)
+    template <typename MutableBufferSequence, typename Handler>
+    mutable_sequence_return_t<MutableBufferSequence, Handler>
+    stream_descriptor::async_read_some(const MutableBufferSequence &buffers, Handler &&handler)
+    {
+        return async_initiate<void(std::error_code, std::size_t)>(
+            [this, buffers](auto &&handler)
+            {
+                using H = decltype(handler);
+                submit_vectored<transfer_op<H>>(
+                    get_uring(), buffers, [&](io_uring_sqe *sqe, iovec_state &state)
+                    {
+                        memset(sqe, 0, sizeof(*sqe));
+                        sqe->opcode = IORING_OP_READV;
+                        this->prepare_fd(sqe);
+                        sqe->addr = reinterpret_cast<__u64>(state.iov);
+                        sqe->len = state.count; },
+                    std::forward<H>(handler));
+            },
+            std::forward<Handler>(handler));
+    }
+
+    template <typename ConstBufferSequence, typename Handler>
+    const_sequence_return_t<ConstBufferSequence, Handler>
+    stream_descriptor::async_write_some(const ConstBufferSequence &buffers, Handler &&handler)
+    {
+        return async_initiate<void(std::error_code, std::size_t)>(
+            [this, buffers](auto &&handler)
             {
-                if (cqe->res < 0)
-                {
-                    handler_(std::error_code(-cqe->res, std::system_category()),
-                             0);
-                }
-                else
-                {
-                    handler_(std::error_code(), cqe->res);
-                }
-            }
-
-            typename std::decay<Handler>::type handler_;
-        };
-
-        get_uring().submit([&](io_uring_sqe *sqe)
-                           {
-                memset(sqe, 0, sizeof(*sqe));
-                sqe->opcode = IORING_OP_WRITE;
-                sqe->fd = this->native_handle();
-                sqe->addr = reinterpret_cast<__u64>(buffer.data());
-                sqe->len = buffer.size();
-                sqe->user_data = wrapped_operation<write_op>::create(std::forward<Handler>(handler)); });
+                using H = decltype(handler);
+                submit_vectored<transfer_op<H>>(
+                    get_uring(), buffers, [&](io_uring_sqe *sqe, iovec_state &state)
+                    {
+                        memset(sqe, 0, sizeof(*sqe));
+                        sqe->opcode = IORING_OP_WRITEV;
+                        this->prepare_fd(sqe);
+                        sqe->addr = reinterpret_cast<__u64>(state.iov);
+                        sqe->len = state.count; },
+                    std::forward<H>(handler));
+            },
+            std::forward<Handler>(handler));
     }
 }
 
@@ -3,10 +3,47 @@
 
 #include <ioring/socket_base.hpp>
 #include <ioring/buffers.hpp>
+#include <ioring/buffer_ring.hpp>
+#include <ioring/vectored.hpp>
 
 namespace ioring
 {
 
+    // Completion of a zero-copy send. The first CQE carries the result and,
+    // with IORING_CQE_F_MORE, announces an IORING_CQE_F_NOTIF CQE that
+    // arrives once the kernel no longer reads the buffer.
+    template <typename Handler, typename ReleaseHandler>
+    struct send_zc_op
+    {
+        template <typename H, typename R>
+        send_zc_op(H &&h, R &&r)
+            : handler(std::forward<H>(h)), released(std::forward<R>(r))
+        {
+        }
+
+        bool operator()(io_uring_cqe *cqe)
+        {
+            if (cqe->flags & IORING_CQE_F_NOTIF)
+            {
+                released((cqe->res & IORING_NOTIF_USAGE_ZC_COPIED) != 0);
+                return false;
+            }
+
+            bool more = cqe->flags & IORING_CQE_F_MORE;
+            if (cqe->res < 0)
+                handler(std::error_code(-cqe->res, std::system_category()), 0);
+            else
+                handler(std::error_code(), cqe->res);
+
+            if (!more)
+                released(false);
+            return false;
+        }
+
+        Handler handler;
+        ReleaseHandler released;
+    };
+
     class stream_socket : public socket_base
     {
     public:
@@ -22,6 +59,11 @@ namespace ioring
             this->assign(sock);
         }
 
+        // Creates the socket with IORING_OP_SOCKET straight into the ring's
+        // registered file table; no process fd is ever allocated.
+        template <typename Protocol, typename Handler>
+        async_return_t<Handler, void(std::error_code)> async_open_direct(const Protocol &protocol, Handler &&handler);
+
         template <typename Endpoint>
         void bind(const Endpoint &endpoint)
         {
@@ -31,101 +73,494 @@ namespace ioring
         }
 
         template <typename Endpoint, typename Handler>
-        void async_connect(const Endpoint &endpoint, Handler &&handler);
+        async_return_t<Handler, void(std::error_code)> async_connect(const Endpoint &endpoint, Handler &&handler);
+
+        template <typename Endpoint, typename Rep, typename Period, typename Handler>
+        async_return_t<Handler, void(std::error_code)> async_connect(const Endpoint &endpoint, std::chrono::duration<Rep, Period> timeout, Handler &&handler);
+
+        template <typename Handler>
+        async_return_t<Handler, void(std::error_code, std::size_t)> async_read_some(mutable_buffer buffer, Handler &&handler);
+
+        // Overloads taking a timeout link an IORING_OP_LINK_TIMEOUT to the
+        // operation, which then fails with std::errc::timed_out if it has not
+        // completed in time.
+        template <typename Rep, typename Period, typename Handler>
+        async_return_t<Handler, void(std::error_code, std::size_t)> async_read_some(mutable_buffer buffer, std::chrono::duration<Rep, Period> timeout, Handler &&handler);
+
+        template <typename Handler>
+        async_return_t<Handler, void(std::error_code, std::size_t)> async_read_some(mutable_registered_buffer buffer, Handler &&handler);
+
+        template <typename Handler>
+        async_return_t<Handler, void(std::error_code, std::size_t)> async_write_some(const_buffer buffer, Handler &&handler);
+
+        template <typename Rep, typename Period, typename Handler>
+        async_return_t<Handler, void(std::error_code, std::size_t)> async_write_some(const_buffer buffer, std::chrono::duration<Rep, Period> timeout, Handler &&handler);
 
         template <typename Handler>
-        void async_read_some(mutable_buffer buffer, Handler &&handler);
+        async_return_t<Handler, void(std::error_code, std::size_t)> async_write_some(const_registered_buffer buffer, Handler &&handler);
 
         template <typename Handler>
-        void async_write_some(const_buffer buffer, Handler &&handler);
+        async_return_t<Handler, void(std::error_code, std::size_t)> async_write_some(mutable_registered_buffer buffer, Handler &&handler)
+        {
+            return async_write_some(const_registered_buffer(buffer), std::forward<Handler>(handler));
+        }
+
+        // Buffer sequences go out as a single IORING_OP_READV / IORING_OP_SENDMSG;
+        // at most iovec_state::max_buffers buffers are transferred at a time.
+        template <typename MutableBufferSequence, typename Handler>
+        mutable_sequence_return_t<MutableBufferSequence, Handler> async_read_some(const MutableBufferSequence &buffers, Handler &&handler);
+
+        template <typename ConstBufferSequence, typename Handler>
+        const_sequence_return_t<ConstBufferSequence, Handler> async_write_some(const ConstBufferSequence &buffers, Handler &&handler);
+
+        // Arms a multishot receive that draws buffers from `buffers`. The
+        // handler is invoked as handler(std::error_code, buffer_lease) for
+        // every chunk of data; an empty lease without an error means the
+        // peer closed the connection. std::errc::no_buffer_space ends the
+        // stream when the ring runs dry and the handler may re-arm it once
+        // leases have been released.
+        template <typename Handler>
+        void async_receive_multishot(buffer_ring &buffers, Handler &&handler);
+
+        // Zero-copy send with IORING_OP_SEND_ZC, or IORING_OP_SENDMSG_ZC for
+        // buffer sequences. handler(std::error_code, std::size_t) reports the
+        // bytes sent, but the kernel may still be reading the buffer then:
+        // it must stay untouched until released(bool copied) runs, after the
+        // notification CQE. `copied` is set when the kernel fell back to
+        // copying the data. The operation is allocated with the allocator
+        // associated with `released`, as it outlives the handler.
+        template <typename ReleaseHandler, typename Handler>
+        async_return_t<Handler, void(std::error_code, std::size_t)> async_send_zc(const_buffer buffer, ReleaseHandler &&released, Handler &&handler);
+
+        template <typename ReleaseHandler, typename Handler>
+        async_return_t<Handler, void(std::error_code, std::size_t)> async_send_zc(const_registered_buffer buffer, ReleaseHandler &&released, Handler &&handler);
+
+        template <typename ConstBufferSequence, typename ReleaseHandler, typename Handler>
+        const_sequence_return_t<ConstBufferSequence, Handler> async_send_zc(const ConstBufferSequence &buffers, ReleaseHandler &&released, Handler &&handler);
+
+    private:
+        template <typename Op, typename Prepare, typename ReleaseHandler, typename Handler, typename... Args>
+        void async_send_zc_impl(Prepare &&prepare, ReleaseHandler &&released, Handler &&handler, Args &&...args);
     };
 
+    template <typename Protocol, typename Handler>
+    async_return_t<Handler, void(std::error_code)>
+    stream_socket::async_open_direct(const Protocol &protocol, Handler &&handler)
+    {
+        return async_initiate<void(std::error_code)>(
+            [this, &protocol](auto &&handler)
+            {
+                using H = decltype(handler);
+                struct open_op
+                {
+                    open_op(stream_socket &sock, H &&h)
+                        : sock_(sock), handler_(std::forward<H>(h))
+                    {
+                    }
+
+                    void operator()(io_uring_cqe *cqe)
+                    {
+                        if (cqe->res < 0)
+                        {
+                            handler_(std::error_code(-cqe->res, std::system_category()));
+                        }
+                        else
+                        {
+                            sock_.assign_direct(cqe->res);
+                            handler_(std::error_code());
+                        }
+                    }
+
+                    stream_socket &sock_;
+                    typename std::decay<H>::type handler_;
+                };
+
+                get_uring().submit([&](io_uring_sqe *sqe)
+                                   {
+                        memset(sqe, 0, sizeof(*sqe));
+                        sqe->opcode = IORING_OP_SOCKET;
+                        sqe->fd = protocol.domain();
+                        sqe->off = protocol.type();
+                        sqe->len = protocol.protocol();
+                        sqe->file_index = IORING_FILE_INDEX_ALLOC;
+                        cancellation_slot slot = get_associated_cancellation_slot(handler);
+                        sqe->user_data = wrapped_operation<open_op>::create(
+                            get_associated_allocator(handler, get_uring().get_allocator()),
+                            *this, std::forward<H>(handler));
+                        slot.assign(get_uring(), sqe->user_data); });
+            },
+            std::forward<Handler>(handler));
+    }
+
     template <typename Endpoint, typename Handler>
-    void stream_socket::async_connect(const Endpoint &endpoint, Handler &&handler)
+    async_return_t<Handler, void(std::error_code)>
+    stream_socket::async_connect(const Endpoint &endpoint, Handler &&handler)
     {
-        this->get_uring().submit([&](io_uring_sqe *sqe)
-                                 {
-                    memset(sqe, 0, sizeof(*sqe));
-                    sqe->opcode = IORING_OP_CONNECT;
-                    sqe->fd = this->native_handle();
-                    sqe->addr = reinterpret_cast<__u64>(endpoint.get());
-                    sqe->off = endpoint.size();
+        return async_initiate<void(std::error_code)>(
+            [this, &endpoint](auto &&handler)
+            {
+                using H = decltype(handler);
+                this->get_uring().submit([&](io_uring_sqe *sqe)
+                                         {
+                            memset(sqe, 0, sizeof(*sqe));
+                            sqe->opcode = IORING_OP_CONNECT;
+                            this->prepare_fd(sqe);
+                            sqe->addr = reinterpret_cast<__u64>(endpoint.get());
+                            sqe->off = endpoint.size();
 
-                    sqe->user_data = wrapped_operation<post_op<typename std::decay<Handler>::type>>::
-                        create(this->get_uring(), std::forward<Handler>(handler)); });
+                            cancellation_slot slot = get_associated_cancellation_slot(handler);
+                            sqe->user_data = wrapped_operation<post_op<typename std::decay<H>::type>>::
+                                create(get_associated_allocator(handler, this->get_uring().get_allocator()),
+                                       this->get_uring(), std::forward<H>(handler));
+                            slot.assign(this->get_uring(), sqe->user_data); });
+            },
+            std::forward<Handler>(handler));
+    }
+
+    template <typename Endpoint, typename Rep, typename Period, typename Handler>
+    async_return_t<Handler, void(std::error_code)>
+    stream_socket::async_connect(const Endpoint &endpoint, std::chrono::duration<Rep, Period> timeout, Handler &&handler)
+    {
+        return async_initiate<void(std::error_code)>(
+            [this, &endpoint, timeout](auto &&handler)
+            {
+                using H = decltype(handler);
+                submit_with_deadline<post_op<typename std::decay<H>::type>>(
+                    get_uring(), std::chrono::ceil<std::chrono::nanoseconds>(timeout), [&](io_uring_sqe *sqe)
+                    {
+                        memset(sqe, 0, sizeof(*sqe));
+                        sqe->opcode = IORING_OP_CONNECT;
+                        this->prepare_fd(sqe);
+                        sqe->addr = reinterpret_cast<__u64>(endpoint.get());
+                        sqe->off = endpoint.size(); },
+                    std::forward<H>(handler), get_uring());
+            },
+            std::forward<Handler>(handler));
     }
 
     template <typename Handler>
-    void stream_socket::async_read_some(mutable_buffer buffer, Handler &&handler)
+    async_return_t<Handler, void(std::error_code, std::size_t)>
+    stream_socket::async_read_some(mutable_buffer buffer, Handler &&handler)
     {
-        struct read_op
-        {
-            explicit read_op(Handler &&h)
-                : handler_(std::forward<Handler>(h))
+        return async_initiate<void(std::error_code, std::size_t)>(
+            [this, buffer](auto &&handler)
             {
-            }
+                using H = decltype(handler);
+                get_uring().submit([&](io_uring_sqe *sqe)
+                                   {
+                        memset(sqe, 0, sizeof(*sqe));
+                        sqe->opcode = IORING_OP_READ;
+                        this->prepare_fd(sqe);
+                        sqe->addr = reinterpret_cast<__u64>(buffer.data());
+                        sqe->len = buffer.size();
+                        sqe->off = 0;
+                        cancellation_slot slot = get_associated_cancellation_slot(handler);
+                        sqe->user_data = wrapped_operation<transfer_op<H>>::create(
+                            get_associated_allocator(handler, get_uring().get_allocator()),
+                            std::forward<H>(handler));
+                        slot.assign(get_uring(), sqe->user_data); });
+            },
+            std::forward<Handler>(handler));
+    }
 
-            void operator()(io_uring_cqe *cqe)
+    template <typename Rep, typename Period, typename Handler>
+    async_return_t<Handler, void(std::error_code, std::size_t)>
+    stream_socket::async_read_some(mutable_buffer buffer, std::chrono::duration<Rep, Period> timeout, Handler &&handler)
+    {
+        return async_initiate<void(std::error_code, std::size_t)>(
+            [this, buffer, timeout](auto &&handler)
             {
-                if (cqe->res < 0)
-                {
-                    handler_(std::error_code(-cqe->res, std::system_category()),
-                             0);
-                }
-                else
-                {
-                    handler_(std::error_code(), cqe->res);
-                }
-            }
+                using H = decltype(handler);
+                submit_with_deadline<transfer_op<H>>(
+                    get_uring(), std::chrono::ceil<std::chrono::nanoseconds>(timeout), [&](io_uring_sqe *sqe)
+                    {
+                        memset(sqe, 0, sizeof(*sqe));
+                        sqe->opcode = IORING_OP_READ;
+                        this->prepare_fd(sqe);
+                        sqe->addr = reinterpret_cast<__u64>(buffer.data());
+                        sqe->len = buffer.size(); },
+                    std::forward<H>(handler));
+            },
+            std::forward<Handler>(handler));
+    }
 
-            typename std::decay<Handler>::type handler_;
-        };
+    template <typename Rep, typename Period, typename Handler>
+    async_return_t<Handler, void(std::error_code, std::size_t)>
+    stream_socket::async_write_some(const_buffer buffer, std::chrono::duration<Rep, Period> timeout, Handler &&handler)
+    {
+        return async_initiate<void(std::error_code, std::size_t)>(
+            [this, buffer, timeout](auto &&handler)
+            {
+                using H = decltype(handler);
+                submit_with_deadline<transfer_op<H>>(
+                    get_uring(), std::chrono::ceil<std::chrono::nanoseconds>(timeout), [&](io_uring_sqe *sqe)
+                    {
+                        memset(sqe, 0, sizeof(*sqe));
+                        sqe->opcode = IORING_OP_WRITE;
+                        this->prepare_fd(sqe);
+                        sqe->addr = reinterpret_cast<__u64>(buffer.data());
+                        sqe->len = buffer.size(); },
+                    std::forward<H>(handler));
+            },
+            std::forward<Handler>(handler));
+    }
+
+    template <typename Handler>
+    async_return_t<Handler, void(std::error_code, std::size_t)>
+    stream_socket::async_read_some(mutable_registered_buffer buffer, Handler &&handler)
+    {
+        return async_initiate<void(std::error_code, std::size_t)>(
+            [this, buffer](auto &&handler)
+            {
+                using H = decltype(handler);
+                get_uring().submit([&](io_uring_sqe *sqe)
+                                   {
+                        memset(sqe, 0, sizeof(*sqe));
+                        sqe->opcode = IORING_OP_READ_FIXED;
+                        this->prepare_fd(sqe);
+                        sqe->addr = reinterpret_cast<__u64>(buffer.data());
+                        sqe->len = buffer.size();
+                        sqe->buf_index = buffer.buffer_index();
+                        cancellation_slot slot = get_associated_cancellation_slot(handler);
+                        sqe->user_data = wrapped_operation<transfer_op<H>>::create(
+                            get_associated_allocator(handler, get_uring().get_allocator()),
+                            std::forward<H>(handler));
+                        slot.assign(get_uring(), sqe->user_data); });
+            },
+            std::forward<Handler>(handler));
+    }
+
+    template <typename Handler>
+    async_return_t<Handler, void(std::error_code, std::size_t)>
+    stream_socket::async_write_some(const_buffer buffer, Handler &&handler)
+    {
+        return async_initiate<void(std::error_code, std::size_t)>(
+            [this, buffer](auto &&handler)
+            {
+                using H = decltype(handler);
+                this->get_uring().submit([&](io_uring_sqe *sqe)
+                                         {
+                        memset(sqe, 0, sizeof(*sqe));
+                        sqe->opcode = IORING_OP_WRITE;
+                        this->prepare_fd(sqe);
+                        sqe->addr = reinterpret_cast<__u64>(buffer.data());
+                        sqe->len = buffer.size();
+                        cancellation_slot slot = get_associated_cancellation_slot(handler);
+                        sqe->user_data = wrapped_operation<transfer_op<H>>::create(
+                            get_associated_allocator(handler, get_uring().get_allocator()),
+                            std::forward<H>(handler));
+                        slot.assign(get_uring(), sqe->user_data); });
+            },
+            std::forward<Handler>(handler));
+    }
+
+    template <typename Handler>
+    async_return_t<Handler, void(std::error_code, std::size_t)>
+    stream_socket::async_write_some(const_registered_buffer buffer, Handler &&handler)
+    {
+        return async_initiate<void(std::error_code, std::size_t)>(
+            [this, buffer](auto &&handler)
+            {
+                using H = decltype(handler);
+                this->get_uring().submit([&](io_uring_sqe *sqe)
+                                         {
+                        memset(sqe, 0, sizeof(*sqe));
+                        sqe->opcode = IORING_OP_WRITE_FIXED;
+                        this->prepare_fd(sqe);
+                        sqe->addr = reinterpret_cast<__u64>(buffer.data());
+                        sqe->len = buffer.size();
+                        sqe->buf_index = buffer.buffer_index();
+                        cancellation_slot slot = get_associated_cancellation_slot(handler);
+                        sqe->user_data = wrapped_operation<transfer_op<H>>::create(
+                            get_associated_allocator(handler, get_uring().get_allocator()),
+                            std::forward<H>(handler));
+                        slot.assign(get_uring(), sqe->user_data); });
+            },
+            std::forward<Handler>(handler));
+    }
+
+    template <typename MutableBufferSequence, typename Handler>
+    mutable_sequence_return_t<MutableBufferSequence, Handler>
+    stream_socket::async_read_some(const MutableBufferSequence &buffers, Handler &&handler)
+    {
+        return async_initiate<void(std::error_code, std::size_t)>(
+            [this, buffers](auto &&handler)
+            {
+                using H = decltype(handler);
+                submit_vectored<transfer_op<H>>(
+                    get_uring(), buffers, [&](io_uring_sqe *sqe, iovec_state &state)
+                    {
+                        memset(sqe, 0, sizeof(*sqe));
+                        sqe->opcode = IORING_OP_READV;
+                        this->prepare_fd(sqe);
+                        sqe->addr = reinterpret_cast<__u64>(state.iov);
+                        sqe->len = state.count; },
+                    std::forward<H>(handler));
+            },
+            std::forward<Handler>(handler));
+    }
+
+    template <typename ConstBufferSequence, typename Handler>
+    const_sequence_return_t<ConstBufferSequence, Handler>
+    stream_socket::async_write_some(const ConstBufferSequence &buffers, Handler &&handler)
+    {
+        return async_initiate<void(std::error_code, std::size_t)>(
+            [this, buffers](auto &&handler)
+            {
+                using H = decltype(handler);
+                submit_vectored<transfer_op<H>>(
+                    get_uring(), buffers, [&](io_uring_sqe *sqe, iovec_state &state)
+                    {
+                        memset(sqe, 0, sizeof(*sqe));
+                        sqe->opcode = IORING_OP_SENDMSG;
+                        this->prepare_fd(sqe);
+                        sqe->addr = reinterpret_cast<__u64>(&state.msg); },
+                    std::forward<H>(handler));
+            },
+            std::forward<Handler>(handler));
+    }
+
+    template <typename ReleaseHandler, typename Handler>
+    async_return_t<Handler, void(std::error_code, std::size_t)>
+    stream_socket::async_send_zc(const_buffer buffer, ReleaseHandler &&released, Handler &&handler)
+    {
+        return async_initiate<void(std::error_code, std::size_t)>(
+            [this, buffer, released = typename std::decay<ReleaseHandler>::type(std::forward<ReleaseHandler>(released))](auto &&handler) mutable
+            {
+                using H = decltype(handler);
+                using op_type = send_zc_op<typename std::decay<H>::type, typename std::decay<ReleaseHandler>::type>;
+                async_send_zc_impl<op_type>(
+                    [&](io_uring_sqe *sqe, op_type &)
+                    {
+                        sqe->opcode = IORING_OP_SEND_ZC;
+                        sqe->addr = reinterpret_cast<__u64>(buffer.data());
+                        sqe->len = buffer.size(); },
+                    std::move(released), std::forward<H>(handler));
+            },
+            std::forward<Handler>(handler));
+    }
+
+    template <typename ReleaseHandler, typename Handler>
+    async_return_t<Handler, void(std::error_code, std::size_t)>
+    stream_socket::async_send_zc(const_registered_buffer buffer, ReleaseHandler &&released, Handler &&handler)
+    {
+        return async_initiate<void(std::error_code, std::size_t)>(
+            [this, buffer, released = typename std::decay<ReleaseHandler>::type(std::forward<ReleaseHandler>(released))](auto &&handler) mutable
+            {
+                using H = decltype(handler);
+                using op_type = send_zc_op<typename std::decay<H>::type, typename std::decay<ReleaseHandler>::type>;
+                async_send_zc_impl<op_type>(
+                    [&](io_uring_sqe *sqe, op_type &)
+                    {
+                        sqe->opcode = IORING_OP_SEND_ZC;
+                        sqe->addr = reinterpret_cast<__u64>(buffer.data());
+                        sqe->len = buffer.size();
+                        sqe->ioprio |= IORING_RECVSEND_FIXED_BUF;
+                        sqe->buf_index = buffer.buffer_index(); },
+                    std::move(released), std::forward<H>(handler));
+            },
+            std::forward<Handler>(handler));
+    }
+
+    template <typename ConstBufferSequence, typename ReleaseHandler, typename Handler>
+    const_sequence_return_t<ConstBufferSequence, Handler>
+    stream_socket::async_send_zc(const ConstBufferSequence &buffers, ReleaseHandler &&released, Handler &&handler)
+    {
+        return async_initiate<void(std::error_code, std::size_t)>(
+            [this, buffers, released = typename std::decay<ReleaseHandler>::type(std::forward<ReleaseHandler>(released))](auto &&handler) mutable
+            {
+                using H = decltype(handler);
+                using op_type = vectored_op<send_zc_op<typename std::decay<H>::type, typename std::decay<ReleaseHandler>::type>>;
+                async_send_zc_impl<op_type>(
+                    [&](io_uring_sqe *sqe, op_type &op)
+                    {
+                        sqe->opcode = IORING_OP_SENDMSG_ZC;
+                        sqe->addr = reinterpret_cast<__u64>(&op.msg); },
+                    std::move(released), std::forward<H>(handler), buffers);
+            },
+            std::forward<Handler>(handler));
+    }
+
+    template <typename Op, typename Prepare, typename ReleaseHandler, typename Handler, typename... Args>
+    void stream_socket::async_send_zc_impl(Prepare &&prepare, ReleaseHandler &&released, Handler &&handler, Args &&...args)
+    {
+        using allocator_type = typename associated_allocator<typename std::decay<ReleaseHandler>::type,
+                                                             recycling_allocator<void>>::type;
+        using op_type = multishot_operation<Op, allocator_type>;
 
         get_uring().submit([&](io_uring_sqe *sqe)
                            {
+                cancellation_slot slot = get_associated_cancellation_slot(handler);
+                __u64 user_data = op_type::create(
+                    get_associated_allocator(released, get_uring().get_allocator()),
+                    std::forward<Args>(args)..., std::forward<Handler>(handler), std::forward<ReleaseHandler>(released));
                 memset(sqe, 0, sizeof(*sqe));
-                sqe->opcode = IORING_OP_READ;
-                sqe->fd = this->native_handle();
-                sqe->addr = reinterpret_cast<__u64>(buffer.data());
-                sqe->len = buffer.size();
-                sqe->off = 0;
-                sqe->user_data = wrapped_operation<read_op>::create(std::forward<Handler>(handler)); });
+                this->prepare_fd(sqe);
+                sqe->ioprio = IORING_SEND_ZC_REPORT_USAGE;
+                prepare(sqe, static_cast<op_type *>(reinterpret_cast<void *>(user_data))->t);
+                sqe->user_data = user_data;
+                slot.assign(get_uring(), user_data); });
     }
 
     template <typename Handler>
-    void stream_socket::async_write_some(const_buffer buffer, Handler &&handler)
+    void stream_socket::async_receive_multishot(buffer_ring &buffers, Handler &&handler)
     {
-        struct write_op
+        struct receive_op
         {
-            explicit write_op(Handler &&h)
-                : handler_(std::forward<Handler>(h))
+            receive_op(stream_socket &sock, buffer_ring &buffers, Handler &&h)
+                : sock_(sock), buffers_(buffers), handler_(std::forward<Handler>(h))
             {
             }
 
-            void operator()(io_uring_cqe *cqe)
+            static void prepare(io_uring_sqe *sqe, const stream_socket &sock, __u16 group_id)
+            {
+                memset(sqe, 0, sizeof(*sqe));
+                sqe->opcode = IORING_OP_RECV;
+                sock.prepare_fd(sqe);
+                sqe->ioprio = IORING_RECV_MULTISHOT;
+                sqe->flags |= IOSQE_BUFFER_SELECT;
+                sqe->buf_group = group_id;
+            }
+
+            bool operator()(io_uring_cqe *cqe)
             {
+                buffer_lease lease;
+                if (cqe->flags & IORING_CQE_F_BUFFER)
+                    lease = buffer_lease(buffers_, static_cast<__u16>(cqe->flags >> IORING_CQE_BUFFER_SHIFT),
+                                         cqe->res > 0 ? cqe->res : 0);
+
                 if (cqe->res < 0)
                 {
-                    handler_(std::error_code(-cqe->res, std::system_category()),
-                             0);
+                    handler_(std::error_code(-cqe->res, std::system_category()), std::move(lease));
+                    return false;
                 }
-                else
+
+                bool rearmed = false;
+                if (cqe->res > 0 && !(cqe->flags & IORING_CQE_F_MORE))
                 {
-                    handler_(std::error_code(), cqe->res);
+                    __u64 user_data = cqe->user_data;
+                    sock_.get_uring().submit([&](io_uring_sqe *sqe)
+                                             {
+                            prepare(sqe, sock_, buffers_.group_id());
+                            sqe->user_data = user_data; });
+                    rearmed = true;
                 }
+
+                handler_(std::error_code(), std::move(lease));
+                return rearmed;
             }
 
+            stream_socket &sock_;
+            buffer_ring &buffers_;
             typename std::decay<Handler>::type handler_;
         };
 
-        this->get_uring().submit([&](io_uring_sqe *sqe)
-                                 {
-                memset(sqe, 0, sizeof(*sqe));
-                sqe->opcode = IORING_OP_WRITE;
-                sqe->fd = this->native_handle();
-                sqe->addr = reinterpret_cast<__u64>(buffer.data());
-                sqe->len = buffer.size();
-                sqe->user_data = wrapped_operation<write_op>::create(std::forward<Handler>(handler)); });
+        get_uring().submit([&](io_uring_sqe *sqe)
+                           {
+                receive_op::prepare(sqe, *this, buffers.group_id());
+                sqe->user_data = multishot_operation<receive_op>::create(
+                    get_associated_allocator(handler, get_uring().get_allocator()),
+                    *this, buffers, std::forward<Handler>(handler)); });
     }
 }
 
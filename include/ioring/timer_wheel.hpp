@@ -0,0 +1,249 @@
+#ifndef IORING_TIMER_WHEEL_HPP
+#define IORING_TIMER_WHEEL_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace ioring
+{
+
+    struct operation;
+
+    // Hierarchical timing wheel with millisecond ticks: six levels of 64
+    // slots each cover about two years, and adding or removing a timer is
+    // O(1). A timer lives in the lowest level whose slot it shares with the
+    // current time at the next level up; when the current time reaches the
+    // start of a higher-level slot, its timers cascade down to finer levels.
+    // The ring arms a single kernel timeout for next_tick().
+    class timer_wheel
+    {
+    public:
+        using clock_type = std::chrono::steady_clock;
+        using tick_duration = std::chrono::milliseconds;
+
+        static constexpr unsigned slot_bits = 6;
+        static constexpr unsigned slots = 1u << slot_bits;
+        static constexpr unsigned levels = 6;
+
+        struct entry
+        {
+            entry *prev = nullptr;
+            entry *next = nullptr;
+            std::uint64_t expiry = 0;
+            unsigned char level = 0;
+            unsigned char slot = 0;
+            bool linked = false;
+
+            // Operations completed when the entry expires, most recent first.
+            operation *waiters = nullptr;
+        };
+
+        explicit timer_wheel(std::uint64_t now = now_tick()) noexcept
+            : now_(now), size_(0)
+        {
+            for (unsigned level = 0; level < levels; ++level)
+            {
+                occupied_[level] = 0;
+                for (unsigned slot = 0; slot < slots; ++slot)
+                    slots_[level][slot] = nullptr;
+            }
+        }
+
+        timer_wheel(const timer_wheel &) = delete;
+        timer_wheel &operator=(const timer_wheel &) = delete;
+
+        static std::uint64_t now_tick() noexcept
+        {
+            return static_cast<std::uint64_t>(
+                std::chrono::duration_cast<tick_duration>(clock_type::now().time_since_epoch()).count());
+        }
+
+        // Rounds up, so that a timer never fires before its expiry time.
+        static std::uint64_t to_tick(clock_type::time_point t) noexcept
+        {
+            auto ticks = std::chrono::ceil<tick_duration>(t.time_since_epoch()).count();
+            return ticks < 0 ? 0 : static_cast<std::uint64_t>(ticks);
+        }
+
+        bool empty() const noexcept
+        {
+            return size_ == 0;
+        }
+
+        std::size_t size() const noexcept
+        {
+            return size_;
+        }
+
+        std::uint64_t now() const noexcept
+        {
+            return now_;
+        }
+
+        // Moves the current time forward while the wheel is empty.
+        void rebase(std::uint64_t now) noexcept
+        {
+            if (size_ == 0 && now > now_)
+                now_ = now;
+        }
+
+        // Adds `e` to expire at tick `expiry`; ticks not after now() expire
+        // on the next tick.
+        void add(entry *e, std::uint64_t expiry) noexcept
+        {
+            e->expiry = expiry;
+            insert(e);
+            ++size_;
+        }
+
+        void remove(entry *e) noexcept
+        {
+            if (!e->linked)
+                return;
+            unlink(e);
+            --size_;
+        }
+
+        // Earliest tick at which advance() has work to do: either a
+        // level-0 slot to expire or a higher-level slot to cascade.
+        std::uint64_t next_tick() const noexcept
+        {
+            std::uint64_t best = UINT64_MAX;
+            for (unsigned level = 0; level < levels; ++level)
+            {
+                std::uint64_t bits = occupied_[level];
+                if (!bits)
+                    continue;
+
+                unsigned shift = slot_bits * level;
+                unsigned current = (now_ >> shift) & (slots - 1);
+                std::uint64_t base = (now_ >> (shift + slot_bits)) << (shift + slot_bits);
+                std::uint64_t later = current == slots - 1 ? 0 : bits & (~std::uint64_t(0) << (current + 1));
+
+                std::uint64_t tick;
+                if (later)
+                    tick = base + (std::uint64_t(__builtin_ctzll(later)) << shift);
+                else
+                    tick = base + (std::uint64_t(1) << (shift + slot_bits)) +
+                           (std::uint64_t(__builtin_ctzll(bits)) << shift);
+
+                if (tick < best)
+                    best = tick;
+            }
+            return best;
+        }
+
+        // Advances the current time to `to`, calling expire(entry *) for
+        // every timer that falls due. Entries are unlinked before the call.
+        template <typename F>
+        void advance(std::uint64_t to, F &&expire)
+        {
+            while (size_ > 0)
+            {
+                std::uint64_t tick = next_tick();
+                if (tick > to)
+                    break;
+                now_ = tick;
+
+                for (unsigned level = levels - 1; level > 0; --level)
+                {
+                    unsigned shift = slot_bits * level;
+                    if (now_ & ((std::uint64_t(1) << shift) - 1))
+                        continue;
+
+                    entry *e = take(level, (now_ >> shift) & (slots - 1));
+                    while (e)
+                    {
+                        entry *next = e->next;
+                        if (e->expiry <= now_)
+                        {
+                            e->prev = e->next = nullptr;
+                            --size_;
+                            expire(e);
+                        }
+                        else
+                        {
+                            insert(e);
+                        }
+                        e = next;
+                    }
+                }
+
+                entry *e = take(0, now_ & (slots - 1));
+                while (e)
+                {
+                    entry *next = e->next;
+                    e->prev = e->next = nullptr;
+                    --size_;
+                    expire(e);
+                    e = next;
+                }
+            }
+
+            if (to > now_)
+                now_ = to;
+        }
+
+    private:
+        void insert(entry *e) noexcept
+        {
+            std::uint64_t expiry = e->expiry > now_ ? e->expiry : now_ + 1;
+
+            // Timers beyond the top level's range wait in its last slot
+            // and are re-inserted when it cascades.
+            std::uint64_t limit = now_ + (std::uint64_t(slots - 1) << (slot_bits * (levels - 1)));
+            if (expiry > limit)
+                expiry = limit;
+
+            unsigned level = 0;
+            while (level < levels - 1 &&
+                   (expiry >> (slot_bits * (level + 1))) != (now_ >> (slot_bits * (level + 1))))
+                ++level;
+            unsigned slot = (expiry >> (slot_bits * level)) & (slots - 1);
+
+            entry *&head = slots_[level][slot];
+            e->prev = nullptr;
+            e->next = head;
+            if (head)
+                head->prev = e;
+            head = e;
+            e->level = static_cast<unsigned char>(level);
+            e->slot = static_cast<unsigned char>(slot);
+            e->linked = true;
+            occupied_[level] |= std::uint64_t(1) << slot;
+        }
+
+        void unlink(entry *e) noexcept
+        {
+            if (e->prev)
+                e->prev->next = e->next;
+            else
+                slots_[e->level][e->slot] = e->next;
+            if (e->next)
+                e->next->prev = e->prev;
+            if (!slots_[e->level][e->slot])
+                occupied_[e->level] &= ~(std::uint64_t(1) << e->slot);
+            e->prev = e->next = nullptr;
+            e->linked = false;
+        }
+
+        entry *take(unsigned level, unsigned slot) noexcept
+        {
+            entry *list = slots_[level][slot];
+            slots_[level][slot] = nullptr;
+            occupied_[level] &= ~(std::uint64_t(1) << slot);
+            for (entry *e = list; e; e = e->next)
+                e->linked = false;
+            return list;
+        }
+
+        std::uint64_t now_;
+        std::size_t size_;
+        std::uint64_t occupied_[levels];
+        entry *slots_[levels][slots];
+    };
+
+}
+
+#endif /* IORING_TIMER_WHEEL_HPP */
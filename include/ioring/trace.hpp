@@ -0,0 +1,98 @@
+#ifndef IORING_TRACE_HPP
+#define IORING_TRACE_HPP
+
+#include <ioring/config.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+#include <linux/io_uring.h>
+
+namespace ioring
+{
+
+    struct trace_event
+    {
+        enum kind_type : std::uint8_t
+        {
+            // An operation was allocated while `parent` was completing.
+            create,
+            // An SQE carrying the operation was queued.
+            submit,
+            // A CQE for the operation was reaped; `duration_ns` covers its
+            // handler.
+            complete,
+        };
+
+        std::uint64_t timestamp_ns;
+        std::uint64_t duration_ns;
+        std::uint64_t op;
+        std::uint64_t parent;
+        std::int32_t fd;
+        std::int32_t res;
+        std::uint32_t flags;
+        std::uint8_t opcode;
+        kind_type kind;
+    };
+
+    // Fixed-size ring of the most recent trace events. Only the ring's
+    // thread records; snapshot() may run on any thread and drops the
+    // events overwritten while it copies.
+    class trace_buffer
+    {
+    public:
+        // `capacity` is rounded up to a power of two.
+        IORING_DECL explicit trace_buffer(std::size_t capacity = 65536);
+
+        void record(const trace_event &e) noexcept
+        {
+            std::uint64_t head = head_.load(std::memory_order_relaxed);
+            events_[head & mask_] = e;
+            head_.store(head + 1, std::memory_order_release);
+        }
+
+        IORING_DECL std::vector<trace_event> snapshot() const;
+
+        // Writes the events in the Chrome trace event format, which
+        // chrome://tracing and Perfetto open. Submissions and completions
+        // of one operation form an async slice named after its opcode;
+        // handlers are complete ("X") slices. `tid` tells rings apart.
+        IORING_DECL void write_chrome_trace(std::ostream &os, int tid = 1) const;
+
+        void clear() noexcept
+        {
+            head_.store(0, std::memory_order_release);
+        }
+
+        static std::uint64_t now_ns() noexcept
+        {
+            return static_cast<std::uint64_t>(
+                std::chrono::steady_clock::now().time_since_epoch() / std::chrono::nanoseconds(1));
+        }
+
+    private:
+        std::unique_ptr<trace_event[]> events_;
+        std::uint64_t mask_;
+        std::atomic<std::uint64_t> head_;
+    };
+
+    IORING_DECL const char *opcode_name(unsigned opcode) noexcept;
+
+    // The operation whose completion is running on this thread; operations
+    // created meanwhile record it as their parent.
+    inline std::uint64_t &trace_parent() noexcept
+    {
+        static thread_local std::uint64_t op = 0;
+        return op;
+    }
+
+}
+
+#include <ioring/impl/trace.ipp>
+
+#endif /* IORING_TRACE_HPP */
@@ -0,0 +1,142 @@
+#ifndef IORING_UDP_HPP
+#define IORING_UDP_HPP
+
+#include <ioring/tcp.hpp>
+
+#include <netinet/udp.h>
+
+namespace ioring
+{
+
+    struct udp
+    {
+        int domain_;
+        int type_;
+        int protocol_;
+
+        using address_v4 = tcp::address_v4;
+        using address_v6 = tcp::address_v6;
+        using endpoint = tcp::endpoint;
+
+        int domain() const
+        {
+            return domain_;
+        }
+
+        int type() const
+        {
+            return type_;
+        }
+
+        int protocol() const
+        {
+            return protocol_;
+        }
+
+        static const udp &v4()
+        {
+            static const udp instance{AF_INET, SOCK_DGRAM, IPPROTO_UDP};
+            return instance;
+        }
+
+        static const udp &v6()
+        {
+            static const udp instance{AF_INET6, SOCK_DGRAM, IPPROTO_UDP};
+            return instance;
+        }
+
+        // Generic receive offload: the kernel may hand consecutive
+        // datagrams of a flow over as one receive of equally sized
+        // segments, see received_datagram::segment_size().
+        struct gro
+        {
+            explicit gro(bool v) noexcept : value_(v)
+            {
+            }
+
+            explicit operator bool() const noexcept
+            {
+                return value_;
+            }
+
+            static constexpr int layer()
+            {
+                return SOL_UDP;
+            }
+
+            static constexpr int name()
+            {
+                return UDP_GRO;
+            }
+
+            void *value() noexcept
+            {
+                return &value_;
+            }
+
+            const void *value() const noexcept
+            {
+                return &value_;
+            }
+
+            socklen_t length() const noexcept
+            {
+                return sizeof(value_);
+            }
+
+            void length(socklen_t len)
+            {
+                (void)len;
+                assert(len == sizeof(value_));
+            }
+
+            int value_;
+        };
+
+        // Generic segmentation offload for every send on the socket: a
+        // payload larger than the segment size goes out as several
+        // datagrams. 0 turns it off.
+        struct segment_size
+        {
+            explicit segment_size(int v) noexcept : value_(v)
+            {
+            }
+
+            static constexpr int layer()
+            {
+                return SOL_UDP;
+            }
+
+            static constexpr int name()
+            {
+                return UDP_SEGMENT;
+            }
+
+            void *value() noexcept
+            {
+                return &value_;
+            }
+
+            const void *value() const noexcept
+            {
+                return &value_;
+            }
+
+            socklen_t length() const noexcept
+            {
+                return sizeof(value_);
+            }
+
+            void length(socklen_t len)
+            {
+                (void)len;
+                assert(len == sizeof(value_));
+            }
+
+            int value_;
+        };
+    };
+
+}
+
+#endif /* IORING_UDP_HPP */
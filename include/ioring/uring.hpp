@@ -2,10 +2,19 @@
 #define IORING_URING_HPP
 
 #include <ioring/config.hpp>
+#include <ioring/recycling_allocator.hpp>
+#include <ioring/associated_allocator.hpp>
+#include <ioring/timer_wheel.hpp>
+#include <ioring/stats.hpp>
+#include <ioring/trace.hpp>
 
 #include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
 
 #include <linux/io_uring.h>
+#include <sys/uio.h>
 
 namespace ioring
 {
@@ -28,7 +37,7 @@ namespace ioring
         std::atomic<__u32> *tail;
         __u32 *ring_mask;
         __u32 *ring_entries;
-        __u32 *overflow;
+        std::atomic<__u32> *overflow;
         io_uring_cqe *cqes;
         std::atomic<__u32> *flags;
     };
@@ -36,76 +45,550 @@ namespace ioring
     struct operation
     {
         void (*complete)(struct io_uring_cqe *cqe);
+        operation *next = nullptr;
+
+        // Result reported when the operation is completed through
+        // uring::enqueue() rather than by the kernel.
+        int result = 0;
+
+#if IORING_ENABLE_STATS
+        // Publish time of the last SQE carrying this operation.
+        std::uint64_t published_ns = 0;
+#endif
+#if IORING_ENABLE_STATS || IORING_ENABLE_TRACING
+        // Opcode of the last SQE carrying this operation.
+        __u8 opcode = 0;
+#endif
     };
 
-    template <typename T>
+    // Completion target for CQEs nobody waits for.
+    inline operation *null_operation() noexcept
+    {
+        static operation op{[](io_uring_cqe *) {}};
+        return &op;
+    }
+
+#if IORING_ENABLE_TRACING
+    // Records the creation of `op` in the trace of the ring running on the
+    // calling thread, if any.
+    IORING_DECL void trace_create(__u64 op) noexcept;
+#endif
+
+    template <typename T, typename Allocator = std::allocator<void>>
     struct wrapped_operation
         : operation
     {
+        using allocator_type = typename std::allocator_traits<Allocator>::template rebind_alloc<wrapped_operation>;
+
         template <typename... Args>
-        explicit wrapped_operation(Args &&...args)
-            : operation{do_complete}, t(std::forward<Args>(args)...)
+        explicit wrapped_operation(const Allocator &alloc, Args &&...args)
+            : operation{do_complete}, alloc(alloc), t(std::forward<Args>(args)...)
         {
         }
 
         static void do_complete(io_uring_cqe *cqe)
         {
             auto self = static_cast<wrapped_operation *>(reinterpret_cast<void *>(cqe->user_data));
+            allocator_type a(self->alloc);
             T t2 = std::move(self->t);
-            delete self;
+            self->~wrapped_operation();
+            a.deallocate(self, 1);
             t2(cqe);
         }
 
+        template <typename Alloc, typename... Args>
+        static __u64 __attribute__((used)) create(const Alloc &alloc, Args &&...args)
+        {
+            using op_type = wrapped_operation<T, Alloc>;
+            typename op_type::allocator_type a(alloc);
+            op_type *op = a.allocate(1);
+            try
+            {
+                ::new (static_cast<void *>(op)) op_type(alloc, std::forward<Args>(args)...);
+            }
+            catch (...)
+            {
+                a.deallocate(op, 1);
+                throw;
+            }
+#if IORING_ENABLE_TRACING
+            trace_create(reinterpret_cast<__u64>(static_cast<void *>(op)));
+#endif
+            return reinterpret_cast<__u64>(static_cast<void *>(op));
+        }
+
+        Allocator alloc;
+        T t;
+    };
+
+    // Operation that may complete several times. T::operator() returns true
+    // when it has re-submitted the SQE with the same user_data; otherwise the
+    // operation is released once the kernel posts a CQE without
+    // IORING_CQE_F_MORE.
+    template <typename T, typename Allocator = std::allocator<void>>
+    struct multishot_operation
+        : operation
+    {
+        using allocator_type = typename std::allocator_traits<Allocator>::template rebind_alloc<multishot_operation>;
+
         template <typename... Args>
-        static __u64 __attribute__((used)) create(Args &&...args)
+        explicit multishot_operation(const Allocator &alloc, Args &&...args)
+            : operation{do_complete}, alloc(alloc), t(std::forward<Args>(args)...)
+        {
+        }
+
+        static void do_complete(io_uring_cqe *cqe)
         {
-            auto *op = new wrapped_operation<T>(std::forward<Args>(args)...);
+            auto self = static_cast<multishot_operation *>(reinterpret_cast<void *>(cqe->user_data));
+            bool more = cqe->flags & IORING_CQE_F_MORE;
+            if (self->t(cqe) || more)
+                return;
+
+            allocator_type a(self->alloc);
+            self->~multishot_operation();
+            a.deallocate(self, 1);
+        }
+
+        template <typename Alloc, typename... Args>
+        static __u64 __attribute__((used)) create(const Alloc &alloc, Args &&...args)
+        {
+            using op_type = multishot_operation<T, Alloc>;
+            typename op_type::allocator_type a(alloc);
+            op_type *op = a.allocate(1);
+            try
+            {
+                ::new (static_cast<void *>(op)) op_type(alloc, std::forward<Args>(args)...);
+            }
+            catch (...)
+            {
+                a.deallocate(op, 1);
+                throw;
+            }
+#if IORING_ENABLE_TRACING
+            trace_create(reinterpret_cast<__u64>(static_cast<void *>(op)));
+#endif
             return reinterpret_cast<__u64>(static_cast<void *>(op));
         }
 
+        Allocator alloc;
         T t;
     };
 
+    class sqe_chain;
+
+    // user_data with the low bit set carries a detached_op rather than an
+    // operation*, which is always at least 8-byte aligned.
+    constexpr __u64 detached_tag = 1;
+
+    // What a detached SQE does; decides which of its failures are reported.
+    enum class detached_op : std::uint8_t
+    {
+        // Every result is dropped.
+        discard,
+        close,
+        shutdown,
+        // -ENOENT and -EALREADY only mean there was nothing left to cancel.
+        cancel,
+    };
+
+    struct detached_failure
+    {
+        detached_op op;
+        // Descriptor (or direct descriptor slot) the SQE was for, or -1.
+        int fd;
+        std::error_code ec;
+    };
+
+    constexpr __u64 detached_user_data(detached_op op, int fd) noexcept
+    {
+        return (static_cast<__u64>(static_cast<std::uint32_t>(fd)) << 32) |
+               (static_cast<__u64>(op) << 1) | detached_tag;
+    }
+
+    // The kernel only posts the CQE of a failed IOSQE_CQE_SKIP_SUCCESS
+    // request when the opcode marks the request as failed, which
+    // IORING_OP_SHUTDOWN does not; its CQE is always posted instead.
+    constexpr bool detached_skips_success(detached_op op) noexcept
+    {
+        return op != detached_op::shutdown;
+    }
+
+    // Completion token for the overloads that submit detached SQEs, such as
+    // descriptor::async_close(detached).
+    struct detached_t
+    {
+        explicit constexpr detached_t() = default;
+    };
+
+    constexpr detached_t detached{};
+
+    // How a ring waits once no completion is ready.
+    struct wait_policy
+    {
+        // Time spent polling the CQ before sleeping in io_uring_enter;
+        // trades CPU for wakeup latency.
+        std::chrono::nanoseconds spin{0};
+
+        // Completions a wait asks the kernel for. Above 1 the wait also
+        // ends after batch_timeout, with whatever has completed by then.
+        unsigned min_complete = 1;
+
+        std::chrono::nanoseconds batch_timeout = std::chrono::microseconds(50);
+    };
+
+    struct uring_options
+    {
+        // IORING_SETUP_* flags passed to io_uring_setup.
+        __u32 flags = IORING_SETUP_SQPOLL;
+
+        // CPU the SQPOLL thread is pinned to; -1 leaves it unpinned.
+        int sq_thread_cpu = -1;
+
+        // Milliseconds the SQPOLL thread spins before going to sleep.
+        unsigned sq_thread_idle = 0;
+
+        // Completion queue size; 0 lets the kernel pick twice the SQ size.
+        unsigned cq_entries = 0;
+
+        wait_policy wait;
+
+        static uring_options sqpoll(unsigned idle_ms = 0, int cpu = -1)
+        {
+            uring_options opts;
+            opts.flags = IORING_SETUP_SQPOLL;
+            opts.sq_thread_idle = idle_ms;
+            opts.sq_thread_cpu = cpu;
+            return opts;
+        }
+
+        // Interrupt-driven ring owned by a single thread; submissions go
+        // through io_uring_enter and task work runs only when reaping.
+        static uring_options single_issuer()
+        {
+            uring_options opts;
+            opts.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN | IORING_SETUP_COOP_TASKRUN;
+            return opts;
+        }
+    };
+
     class uring
     {
     public:
-        IORING_DECL explicit uring(int queue_depth);
+        using options = uring_options;
+
+        IORING_DECL explicit uring(int queue_depth, const options &opts = options());
 
         IORING_DECL ~uring();
 
         template <typename F>
         void submit(F &&f)
         {
-            __u32 tail = sqring_.tail->load(std::memory_order_relaxed);
-            if (tail + 1 == sqring_.head->load(std::memory_order_acquire))
+            push(f);
+
+            ++pending_;
+
+            if (batch_depth_ == 0)
+                flush();
+        }
+
+        // Queues an SQE nobody waits for. It carries `op` and `fd` in a
+        // tagged user_data instead of an operation, so nothing is allocated,
+        // and IOSQE_CQE_SKIP_SUCCESS spares its CQE unless it fails; kernels
+        // without IORING_FEAT_CQE_SKIP post it anyway and it is dropped.
+        // Failures go to the error sink. Detached SQEs do not keep run()
+        // going.
+        template <typename F>
+        void submit_detached(detached_op op, int fd, F &&f)
+        {
+            push([&](io_uring_sqe *sqe)
+                 {
+                    f(sqe);
+                    if ((features_ & IORING_FEAT_CQE_SKIP) && detached_skips_success(op))
+                        sqe->flags |= IOSQE_CQE_SKIP_SUCCESS;
+                    sqe->user_data = detached_user_data(op, fd); });
+
+            if (batch_depth_ == 0)
+                flush();
+        }
+
+        // Receives the failures of detached SQEs on the ring's thread.
+        // Without a sink they are dropped.
+        void set_error_sink(void (*sink)(void *context, const detached_failure &failure), void *context = nullptr) noexcept
+        {
+            error_sink_ = sink;
+            error_sink_context_ = context;
+        }
+
+        // Waits until `count` SQEs are free, so that the next `count`
+        // submissions inside a submission_batch reach the kernel together;
+        // linked SQEs must not be split across two publications.
+        void reserve(unsigned count)
+        {
+            if (sq_tail_ - sqring_.head->load(std::memory_order_acquire) + count <= *sqring_.ring_entries)
+                return;
+
+#if IORING_ENABLE_STATS
+            ++stats_.sq_full_stalls;
+#endif
+            do
+            {
+                flush();
                 wait();
+            } while (sq_tail_ - sqring_.head->load(std::memory_order_acquire) + count > *sqring_.ring_entries);
+        }
+
+        // Publishes SQEs queued inside a submission_batch to the kernel.
+        // Without SQPOLL the published entries are handed over by the next
+        // io_uring_enter, which run() combines with waiting for completions.
+        void flush()
+        {
+            if (sq_tail_ == sq_flushed_)
+                return;
+
+#if IORING_ENABLE_STATS
+            record_publish();
+#endif
+            sq_flushed_ = sq_tail_;
+            sqring_.tail->store(sq_flushed_, std::memory_order_release);
+
+            if ((flags_ & IORING_SETUP_SQPOLL) &&
+                (sqring_.flags->load(std::memory_order_acquire) & IORING_SQ_NEED_WAKEUP))
+                wakeup();
+        }
+
+        // Runs handlers until the ring has no more work.
+        IORING_DECL void run();
+
+        // Runs the handlers that are ready without blocking. Returns the
+        // number of completions processed, not counting the ring's own.
+        IORING_DECL std::size_t poll();
+
+        // Blocks until one completion has been processed; returns 0 when
+        // the ring has no work. The ring's own completions, such as its
+        // wakeup read and timer-wheel timeout, do not count.
+        IORING_DECL std::size_t run_one();
+
+        // Like run(), but returns once `deadline` has passed. Waits are
+        // bounded by an IORING_ENTER_EXT_ARG timeout.
+        IORING_DECL std::size_t run_until(std::chrono::steady_clock::time_point deadline);
+
+        template <typename Rep, typename Period>
+        std::size_t run_for(std::chrono::duration<Rep, Period> duration)
+        {
+            return run_until(std::chrono::steady_clock::now() +
+                             std::chrono::duration_cast<std::chrono::steady_clock::duration>(duration));
+        }
+
+        void set_wait_policy(const wait_policy &policy) noexcept
+        {
+            wait_ = policy;
+        }
+
+        const wait_policy &get_wait_policy() const noexcept
+        {
+            return wait_;
+        }
+
+        // Starts a chain of linked SQEs; see <ioring/sqe_chain.hpp>.
+        inline sqe_chain chain() noexcept;
 
+        // Queues an operation to be completed on the thread running the ring.
+        // It is completed with a CQE carrying op->result. Safe to call from any
+        // thread. On the ring's own thread it goes to a local FIFO that run()
+        // drains between CQE batches, without touching the kernel; other
+        // threads wake the ring through an eventfd read kept in flight, at
+        // most once per batch of queued operations.
+        IORING_DECL void enqueue(operation *op);
+
+        // Links `timer` into the ring's timer wheel; its waiters are completed
+        // with res == 0 once `expiry` has passed. Only one kernel timeout is
+        // kept armed, for the earliest tick the wheel needs to look at.
+        IORING_DECL void schedule_timer(timer_wheel::entry &timer, std::chrono::steady_clock::time_point expiry);
+
+        IORING_DECL void cancel_timer(timer_wheel::entry &timer) noexcept;
+
+        bool running_in_this_thread() const noexcept
+        {
+            return current() == this;
+        }
+
+        // The ring whose run() is executing on the calling thread, if any.
+        static uring *current_ring() noexcept
+        {
+            return current();
+        }
+
+        // Enables a ring created with IORING_SETUP_R_DISABLED. With
+        // IORING_SETUP_SINGLE_ISSUER the calling thread becomes the only
+        // thread allowed to submit to the ring.
+        IORING_DECL void enable();
+
+        IORING_DECL void register_buffers(const iovec *iovecs, unsigned count);
+
+        IORING_DECL void register_buffers_sparse(unsigned count);
+
+        IORING_DECL void update_buffers(unsigned offset, const iovec *iovecs, unsigned count);
+
+        IORING_DECL void unregister_buffers();
+
+        IORING_DECL void register_buffer_ring(const io_uring_buf_reg &reg);
+
+        IORING_DECL void register_files(const int *fds, unsigned count);
+
+        IORING_DECL void register_files_sparse(unsigned count);
+
+        IORING_DECL void update_files(unsigned offset, const int *fds, unsigned count);
+
+        IORING_DECL void register_file_alloc_range(unsigned offset, unsigned length);
+
+        IORING_DECL void unregister_files();
+
+        IORING_DECL void unregister_buffer_ring(__u16 group_id);
+
+        int native_handle() const noexcept
+        {
+            return fd_;
+        }
+
+        recycling_allocator<void> get_allocator() noexcept
+        {
+            return recycling_allocator<void>(pool_);
+        }
+
+        // Completions the kernel had to drop because the CQ was full and it
+        // could not queue them; with IORING_FEAT_NODROP this stays 0 unless
+        // the kernel ran out of memory for its overflow backlog.
+        std::uint32_t cq_overflow() const noexcept
+        {
+            return cqring_.overflow->load(std::memory_order_relaxed);
+        }
+
+        // Times the reaper found completions waiting in the kernel's
+        // overflow backlog and flushed them into the CQ. A growing count
+        // means the CQ is too small for the load; see
+        // uring_options::cq_entries.
+        std::uint64_t cq_overflow_flushes() const noexcept
+        {
+            return cq_overflow_flushes_;
+        }
+
+#if IORING_ENABLE_TRACING
+        // The ring's recent operations; see trace_buffer::write_chrome_trace.
+        trace_buffer &trace() noexcept
+        {
+            return trace_;
+        }
+#endif
+
+#if IORING_ENABLE_STATS
+        // A copy of the ring's counters; call on the ring's thread.
+        ring_stats stats() const
+        {
+            return stats_;
+        }
+
+        void reset_stats() noexcept
+        {
+            stats_ = ring_stats();
+        }
+#endif
+
+    private:
+        struct ring_operation : operation
+        {
+            uring *ring;
+        };
+
+        template <typename F>
+        void push(F &&f)
+        {
+            reserve(1);
+
+            __u32 tail = sq_tail_;
             __u32 index = tail & *sqring_.ring_mask;
             io_uring_sqe *sqe = &sqring_.sqes[index];
             f(sqe);
             sqring_.array[index] = index;
-            ++tail;
-
-            ++pending_;
+            sq_tail_ = tail + 1;
+
+#if IORING_ENABLE_STATS
+            record_submit(sqe);
+#endif
+#if IORING_ENABLE_TRACING
+            trace_submit(sqe);
+#endif
+        }
 
-            sqring_.tail->store(tail, std::memory_order_release);
+        static uring *&current() noexcept
+        {
+            static thread_local uring *ring = nullptr;
+            return ring;
+        }
 
-            if (sqring_.flags->load(std::memory_order_acquire) & IORING_SQ_NEED_WAKEUP)
-                wakeup();
+        bool has_work() const noexcept
+        {
+            return pending_ > (wake_armed_ ? 1u : 0u) + (timeout_armed_ ? 1u : 0u) ||
+                   posted_count_.load(std::memory_order_acquire) > 0 ||
+                   local_head_ ||
+                   !timers_.empty();
         }
 
-        IORING_DECL void run();
+        IORING_DECL void arm_wake();
+
+        IORING_DECL static void wake_complete(io_uring_cqe *cqe);
+
+        IORING_DECL unsigned run_posted(unsigned limit);
+
+        IORING_DECL unsigned run_local(unsigned limit);
+
+        IORING_DECL void complete_posted(operation *op);
+
+        IORING_DECL void arm_timeout(std::uint64_t tick);
+
+        IORING_DECL static void timeout_complete(io_uring_cqe *cqe);
+
+        IORING_DECL void enter_flushed();
 
-    private:
         IORING_DECL void wakeup();
 
         IORING_DECL void wait();
 
-        IORING_DECL void wait_complete();
+        IORING_DECL bool ready() const noexcept;
+
+        IORING_DECL void wait_complete(const std::chrono::steady_clock::time_point *deadline);
+
+        IORING_DECL unsigned reap(unsigned limit);
+
+        IORING_DECL void complete_detached(const io_uring_cqe *cqe);
 
-        IORING_DECL unsigned complete();
+        IORING_DECL bool cq_overflowed() const noexcept;
+
+        IORING_DECL void flush_overflow();
+
+        IORING_DECL int enter(unsigned min_complete, unsigned flags, const __kernel_timespec *timeout = nullptr);
+
+        struct run_scope;
+
+#if IORING_ENABLE_STATS
+        IORING_DECL void record_submit(const io_uring_sqe *sqe) noexcept;
+
+        IORING_DECL void record_publish() noexcept;
+
+        IORING_DECL void record_complete(operation *op, const io_uring_cqe *cqe, std::uint64_t now_ns) noexcept;
+#endif
+
+#if IORING_ENABLE_TRACING
+        IORING_DECL void trace_submit(const io_uring_sqe *sqe) noexcept;
+
+        IORING_DECL void trace_completion(operation *op, io_uring_cqe *cqe);
+#endif
+
+        IORING_DECL void do_register(unsigned opcode, const void *arg, unsigned nr_args, const char *what);
 
         int fd_;
+        __u32 flags_;
+        __u32 features_;
+        wait_policy wait_;
 
         __u32 sq_len_;
         void *sq_ptr_;
@@ -120,10 +603,97 @@ namespace ioring
         cq_ring cqring_;
 
         __u32 pending_;
+
+        __u32 sq_tail_;
+        __u32 sq_flushed_;
+        __u32 sq_entered_;
+        unsigned batch_depth_;
+
+        operation_pool pool_;
+
+        // Operations queued by enqueue(), pushed as a LIFO stack and
+        // reversed when the ring thread takes the whole list. What a
+        // limited run_posted() leaves over waits in posted_ready_.
+        std::atomic<operation *> posted_;
+        std::atomic<std::size_t> posted_count_;
+        operation *posted_ready_;
+
+        // Operations enqueued on the ring's thread, in FIFO order. One call
+        // of run_local() runs at most local_run_chunk of those queued before
+        // it started, so handlers that keep posting cannot hold off the CQ.
+        // Rings with IORING_SETUP_DEFER_TASKRUN also get their task work run
+        // every local_run_chunk handlers.
+        operation *local_head_;
+        operation *local_tail_;
+        unsigned local_since_enter_;
+        static constexpr unsigned local_run_chunk = 128;
+        std::atomic<bool> wake_requested_;
+        int wake_fd_;
+        bool wake_armed_;
+        __u64 wake_value_;
+        ring_operation wake_op_;
+
+        // The kernel timeout driving timers_ does not count as work by
+        // itself; an armed but stale timeout is harmless and is not removed.
+        timer_wheel timers_;
+        __kernel_timespec timeout_ts_;
+        std::uint64_t timeout_tick_;
+        bool timeout_armed_;
+        ring_operation timeout_op_;
+
+        // CQEs completed between two publications of the CQ head.
+        static constexpr unsigned cq_release_chunk = 32;
+        std::uint64_t cq_overflow_flushes_;
+
+        void (*error_sink_)(void *context, const detached_failure &failure);
+        void *error_sink_context_;
+
+#if IORING_ENABLE_STATS
+        ring_stats stats_;
+#endif
+#if IORING_ENABLE_TRACING
+        trace_buffer trace_{IORING_TRACE_CAPACITY};
+#endif
+
+        friend class submission_batch;
+    };
+
+    // Defers publishing the SQ tail until the outermost batch on the ring
+    // goes out of scope, so a burst of submissions costs one release store
+    // and at most one wakeup.
+    class submission_batch
+    {
+    public:
+        explicit submission_batch(uring &ring) noexcept
+            : ring_(ring)
+        {
+            ++ring_.batch_depth_;
+        }
+
+        submission_batch(const submission_batch &) = delete;
+        submission_batch &operator=(const submission_batch &) = delete;
+
+        ~submission_batch()
+        {
+            if (--ring_.batch_depth_ == 0)
+            {
+                try
+                {
+                    ring_.flush();
+                }
+                catch (...)
+                {
+                }
+            }
+        }
+
+    private:
+        uring &ring_;
     };
 
 }
 
+#include <ioring/sqe_chain.hpp>
 #include <ioring/impl/uring.ipp>
 
 #endif /* IORING_URING_HPP */
@@ -0,0 +1,58 @@
+#ifndef IORING_URING_POOL_HPP
+#define IORING_URING_POOL_HPP
+
+#include <ioring/uring.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace ioring
+{
+
+    // One ring per core, each run by its own thread pinned to that core.
+    // Rings are not thread-safe, so everything started on a ring must stay
+    // on that ring's thread once run() has been called.
+    class uring_pool
+    {
+    public:
+        IORING_DECL explicit uring_pool(std::size_t size, int queue_depth = 256,
+                                        const uring::options &opts = uring::options::single_issuer());
+
+        uring_pool(const uring_pool &) = delete;
+        uring_pool &operator=(const uring_pool &) = delete;
+
+        std::size_t size() const noexcept
+        {
+            return rings_.size();
+        }
+
+        uring &get(std::size_t index) const noexcept
+        {
+            return *rings_[index];
+        }
+
+        // Picks rings round-robin.
+        uring &next() noexcept
+        {
+            uring &ring = *rings_[next_];
+            next_ = (next_ + 1) % rings_.size();
+            return ring;
+        }
+
+        // Runs every ring on its own thread and returns once all of them are
+        // out of work. Ring `index` is pinned to the index-th CPU the calling
+        // thread may run on, wrapping around; failing to pin is reported
+        // like an exception from the ring's run().
+        IORING_DECL void run();
+
+    private:
+        std::vector<std::unique_ptr<uring>> rings_;
+        std::size_t next_;
+    };
+
+}
+
+#include <ioring/impl/uring_pool.ipp>
+
+#endif /* IORING_URING_POOL_HPP */
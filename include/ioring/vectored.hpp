@@ -0,0 +1,103 @@
+#ifndef IORING_VECTORED_HPP
+#define IORING_VECTORED_HPP
+
+#include <ioring/uring.hpp>
+#include <ioring/buffers.hpp>
+#include <ioring/async_result.hpp>
+#include <ioring/cancellation.hpp>
+
+#include <cstring>
+#include <system_error>
+#include <type_traits>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+namespace ioring
+{
+
+    // The iovec array, and the msghdr for IORING_OP_SENDMSG, of a vectored
+    // operation. The kernel may read them until the operation completes, so
+    // they live in the operation. Buffers past max_buffers are left out: the
+    // operation transfers part of the sequence, as any "some" operation may.
+    struct iovec_state
+    {
+        static constexpr unsigned max_buffers = 16;
+
+        template <typename Buffers>
+        explicit iovec_state(const Buffers &buffers) noexcept
+        {
+            for (auto i = buffer_sequence_begin(buffers), e = buffer_sequence_end(buffers);
+                 i != e && count < max_buffers; ++i)
+            {
+                const_buffer buffer(*i);
+                if (buffer.size() == 0)
+                    continue;
+                iov[count].iov_base = const_cast<void *>(buffer.data());
+                iov[count].iov_len = buffer.size();
+                ++count;
+            }
+
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = iov;
+            msg.msg_iovlen = count;
+        }
+
+        iovec iov[max_buffers];
+        unsigned count = 0;
+        msghdr msg;
+    };
+
+    template <typename Op>
+    struct vectored_op
+        : iovec_state
+    {
+        template <typename Buffers, typename... Args>
+        explicit vectored_op(const Buffers &buffers, Args &&...args)
+            : iovec_state(buffers), op(std::forward<Args>(args)...)
+        {
+        }
+
+        decltype(auto) operator()(io_uring_cqe *cqe)
+        {
+            return op(cqe);
+        }
+
+        Op op;
+    };
+
+    // Submits the SQE filled in by prepare(io_uring_sqe *, iovec_state &).
+    // The completion is an Op constructed from the handler.
+    template <typename Op, typename Buffers, typename Prepare, typename Handler>
+    void submit_vectored(uring &ring, const Buffers &buffers, Prepare &&prepare, Handler &&handler)
+    {
+        using allocator_type = typename associated_allocator<typename std::decay<Handler>::type,
+                                                             recycling_allocator<void>>::type;
+        using op_type = wrapped_operation<vectored_op<Op>, allocator_type>;
+
+        ring.submit([&](io_uring_sqe *sqe)
+                    {
+                cancellation_slot slot = get_associated_cancellation_slot(handler);
+                __u64 user_data = op_type::create(
+                    get_associated_allocator(handler, ring.get_allocator()),
+                    buffers, std::forward<Handler>(handler));
+                prepare(sqe, static_cast<op_type *>(reinterpret_cast<void *>(user_data))->t);
+                sqe->user_data = user_data;
+                slot.assign(ring, user_data); });
+    }
+
+    // Return types of the buffer sequence overloads. Single buffers keep
+    // resolving to the plain overloads.
+    template <typename Buffers, typename Handler>
+    using mutable_sequence_return_t = typename std::enable_if<
+        is_mutable_buffer_sequence<Buffers>::value && !std::is_convertible<Buffers, mutable_buffer>::value,
+        async_return_t<Handler, void(std::error_code, std::size_t)>>::type;
+
+    template <typename Buffers, typename Handler>
+    using const_sequence_return_t = typename std::enable_if<
+        is_const_buffer_sequence<Buffers>::value && !std::is_convertible<Buffers, const_buffer>::value,
+        async_return_t<Handler, void(std::error_code, std::size_t)>>::type;
+
+}
+
+#endif /* IORING_VECTORED_HPP */
@@ -0,0 +1,66 @@
+#include <ioring/random_access_file.hpp>
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+
+#include <unistd.h>
+
+using namespace ioring;
+
+static int failures = 0;
+
+static void expect(bool ok, const char *what)
+{
+    if (!ok)
+    {
+        std::cerr << "FAILED: " << what << std::endl;
+        ++failures;
+    }
+}
+
+// Syncs [offset, offset + length) and returns the error it completed with.
+static std::error_code sync_range(uring &ring, random_access_file &file, std::uint64_t offset, std::uint64_t length)
+{
+    std::error_code result = std::make_error_code(std::errc::interrupted);
+    bool done = false;
+    file.async_sync_file_range(offset, length, SYNC_FILE_RANGE_WRITE,
+                               [&](std::error_code ec)
+                               {
+                                   result = ec;
+                                   done = true;
+                               });
+    ring.run();
+    expect(done, "sync_file_range completed");
+    return result;
+}
+
+int main()
+{
+    char path[] = "/tmp/ioring_raf_XXXXXX";
+    int fd = ::mkstemp(path);
+    if (fd < 0)
+    {
+        std::perror("mkstemp");
+        return EXIT_FAILURE;
+    }
+    ::unlink(path);
+
+    uring ring(8);
+    random_access_file file(ring);
+    file.assign(fd);
+
+    char data[4096] = {'x'};
+    expect(::pwrite(fd, data, sizeof(data), 0) == static_cast<ssize_t>(sizeof(data)), "pwrite");
+
+    const std::uint64_t gib = std::uint64_t(1) << 30;
+    expect(!sync_range(ring, file, 0, sizeof(data)), "sync of a short range succeeds");
+    expect(!sync_range(ring, file, 0, 0), "sync to the end of the file succeeds");
+    expect(!sync_range(ring, file, 0, 4 * gib - 1), "sync of the longest range the SQE carries succeeds");
+    expect(sync_range(ring, file, 0, 4 * gib) == std::errc::invalid_argument,
+           "sync of exactly 4 GiB is rejected, not sent as length 0");
+    expect(sync_range(ring, file, 0, 5 * gib) == std::errc::invalid_argument,
+           "sync of 5 GiB is rejected, not truncated to 1 GiB");
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,56 @@
+#include <ioring/steady_timer.hpp>
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+
+using namespace ioring;
+
+static int failures = 0;
+
+static void expect(bool ok, const char *what)
+{
+    if (!ok)
+    {
+        std::cerr << "FAILED: " << what << std::endl;
+        ++failures;
+    }
+}
+
+int main()
+{
+    uring ring(8);
+
+    // Timers expiring on the same tick, each with a handler that throws.
+    steady_timer a(ring), b(ring), c(ring);
+    int ran = 0;
+    for (steady_timer *timer : {&a, &b, &c})
+    {
+        timer->expires_after(std::chrono::milliseconds(5));
+        timer->async_wait([&](std::error_code ec)
+                          {
+                if (ec)
+                    return;
+                ++ran;
+                throw std::runtime_error("handler failed"); });
+    }
+
+    int caught = 0;
+    for (;;)
+    {
+        try
+        {
+            ring.run();
+            break;
+        }
+        catch (const std::runtime_error &)
+        {
+            ++caught;
+        }
+    }
+
+    expect(ran == 3, "every expired handler runs although the first throws");
+    expect(caught == 3, "each exception leaves run()");
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
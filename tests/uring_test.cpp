@@ -0,0 +1,56 @@
+#include <ioring/uring.hpp>
+#include <ioring/post.hpp>
+#include <ioring/steady_timer.hpp>
+
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+using namespace ioring;
+
+static int failures = 0;
+
+static void expect(bool ok, const char *what)
+{
+    if (!ok)
+    {
+        std::cerr << "FAILED: " << what << std::endl;
+        ++failures;
+    }
+}
+
+int main()
+{
+    for (uring::options opts : {uring::options(), uring::options::single_issuer()})
+    {
+        uring ring(8, opts);
+
+        // The timer-wheel TIMEOUT completes before the timer's handler runs.
+        steady_timer timer(ring);
+        bool expired = false;
+        timer.expires_after(std::chrono::milliseconds(5));
+        timer.async_wait([&](std::error_code ec)
+                         { expired = !ec; });
+        expect(ring.run_one() == 1, "run_one reports the timer");
+        expect(expired, "run_one runs the timer's handler, not just the ring's timeout");
+
+        // A post from another thread completes the ring's wakeup read first.
+        // The timer keeps run_one waiting until the post arrives.
+        bool posted = false;
+        timer.expires_after(std::chrono::seconds(5));
+        timer.async_wait([](std::error_code) {});
+        std::thread poster([&]
+                           {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                post(ring, [&](std::error_code)
+                     { posted = true; }); });
+        expect(ring.run_one() == 1, "run_one reports the post");
+        expect(posted, "run_one runs the posted handler, not just the ring's wakeup");
+        poster.join();
+
+        timer.cancel();
+        ring.run();
+    }
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}